@@ -0,0 +1,36 @@
+#!/bin/bash
+# threads asking for the same F(k) at once, with and without coalescing
+#
+# usage: sudo ./bench_coalesce.sh [index] [mode] [threads] [seconds]
+#   e.g. sudo ./bench_coalesce.sh 100000 10 1,2,4,8,16 5
+#
+# fib_bench -d fixed runs the threads on one shared file, once with the
+# coalesce parameter off and once on. One CSV row per thread count and
+# setting: "coalesce", the columns of fib_bench, then how many requests
+# calculated and how many joined one in flight (both 0 when off).
+# Mode 8 would answer the repeats from its memo, hence mode 10.
+
+INDEX=${1:-100000}
+MODE=${2:-10}
+THREADS=${3:-"1,2,4,8,16"}
+SECONDS_PER_RUN=${4:-5}
+PARAM=/sys/module/fibdrv/parameters
+STAT=/sys/class/fibonacci/fibonacci/coalesce
+
+saved=$(cat $PARAM/max_index)
+saved_coalesce=$(cat $PARAM/coalesce)
+trap 'echo $saved > $PARAM/max_index; echo $saved_coalesce > $PARAM/coalesce' EXIT
+[ $INDEX -gt $saved ] && echo $INDEX > $PARAM/max_index
+
+echo "coalesce,threads,mode,dist,requests,errors,seconds,qps,p50_ns,p90_ns,p99_ns,p999_ns,max_ns,computed,joined"
+for c in N Y
+do
+    echo $c > $PARAM/coalesce
+    for t in ${THREADS//,/ }
+    do
+        computed=$(cat $STAT/computed)
+        joined=$(cat $STAT/joined)
+        row=$(./fib_bench -t $t -m $MODE -d fixed -k $INDEX -T $SECONDS_PER_RUN | tail -n 1)
+        echo "$c,$row,$(($(cat $STAT/computed) - computed)),$(($(cat $STAT/joined) - joined))"
+    done
+done
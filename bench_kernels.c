@@ -0,0 +1,225 @@
+/* bench_kernels.c */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "bn_kernels.h"
+
+/*
+ * Checks the add/sub kernels of bn_kernels.h against their portable versions
+ * and times both for 1 ~ MAX_LIMBS limbs. One line per limb count:
+ *
+ *   limbs add_ns add_generic_ns sub_ns sub_generic_ns
+ *
+ * in nanoseconds per limb. The output feeds plot_kernels.gp.
+ *
+ * With "mul" the fixed width multiplication and squaring are checked against
+ * the row by row loops of fibdrv.c instead, and timed for 1 ~ BN_FIXED_MAX
+ * limbs a side:
+ *
+ *   limbs mul_fixed_ns mul_rows_ns sqr_fixed_ns sqr_rows_ns
+ *
+ * in nanoseconds per product, for plot_kernels_mul.gp. The outcome turns on
+ * the optimization level: build it with the -O0 of the module as well as
+ * with -O2 before changing BN_FIXED_USE in fibdrv.c.
+ */
+
+#define MAX_LIMBS 4096
+/* limbs processed per measurement, spread over as many calls as it takes */
+#define WORK (1 << 24)
+
+static u64 a[MAX_LIMBS], b[MAX_LIMBS], r1[MAX_LIMBS], r2[MAX_LIMBS];
+
+static u64 rand64(void)
+{
+    return ((u64) rand() << 62) ^ ((u64) rand() << 31) ^ rand();
+}
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* the kernels must agree with the portable code, carries included */
+static int check(long n)
+{
+    u64 c1 = bn_add_n(r1, a, b, n);
+    u64 c2 = bn_add_n_generic(r2, a, b, n, 0);
+    if (c1 != c2 || memcmp(r1, r2, n * sizeof(u64))) {
+        return -1;
+    }
+
+    c1 = bn_sub_n(r1, a, b, n);
+    c2 = bn_sub_n_generic(r2, a, b, n, 0);
+    if (c1 != c2 || memcmp(r1, r2, n * sizeof(u64))) {
+        return -1;
+    }
+
+    /* in place, as bignum_limb_add uses them */
+    memcpy(r1, a, n * sizeof(u64));
+    memcpy(r2, a, n * sizeof(u64));
+    c1 = bn_add_n(r1, r1, b, n);
+    c2 = bn_add_n_generic(r2, r2, b, n, 0);
+    if (c1 != c2 || memcmp(r1, r2, n * sizeof(u64))) {
+        return -1;
+    }
+
+    return 0;
+}
+
+/* r[0 .. 2n) = a * b, as bignum_limb_mul does it past the fixed widths */
+static void mul_rows(u64 *r, const u64 *a, const u64 *b, long n)
+{
+    memset(r, 0, sizeof(u64) * 2 * n);
+    for (long i = 0; i < n; ++i) {
+        u64 carry = 0;
+        for (long j = 0; j < n; ++j) {
+            unsigned __int128 t = (unsigned __int128) a[i] * b[j] + r[i + j] + carry;
+            r[i + j] = (u64) t;
+            carry = (u64) (t >> 64);
+        }
+        r[i + n] = carry;
+    }
+}
+
+/* r[0 .. 2n) = a^2, as bn_sqr_raw does it past the fixed widths */
+static void sqr_rows(u64 *r, const u64 *a, long n)
+{
+    memset(r, 0, sizeof(u64) * 2 * n);
+    for (long i = 0; i < n - 1; ++i) {
+        u64 carry = 0;
+        for (long j = i + 1; j < n; ++j) {
+            unsigned __int128 t = (unsigned __int128) a[i] * a[j] + r[i + j] + carry;
+            r[i + j] = (u64) t;
+            carry = (u64) (t >> 64);
+        }
+        r[i + n] = carry;
+    }
+
+    u64 shifted = 0, carry = 0;
+    for (long i = 0; i < n; ++i) {
+        unsigned __int128 sq = (unsigned __int128) a[i] * a[i];
+        u64 lo = r[2 * i], hi = r[2 * i + 1];
+
+        unsigned __int128 t = (unsigned __int128) ((lo << 1) | shifted) + (u64) sq + carry;
+        r[2 * i] = (u64) t;
+        shifted = lo >> 63;
+
+        t = (unsigned __int128) ((hi << 1) | shifted) + (u64) (sq >> 64) + (u64) (t >> 64);
+        r[2 * i + 1] = (u64) t;
+        shifted = hi >> 63;
+        carry = (u64) (t >> 64);
+    }
+}
+
+/* the fixed width kernels must agree with the loops, all-ones limbs included */
+static int check_mul(long n)
+{
+    static u64 p1[2 * BN_FIXED_MAX], p2[2 * BN_FIXED_MAX];
+    u64 ones[BN_FIXED_MAX];
+
+    memset(ones, 0xff, sizeof(ones));
+    bn_mul_fixed(p1, a, b, n);
+    mul_rows(p2, a, b, n);
+    if (memcmp(p1, p2, 2 * n * sizeof(u64))) {
+        return -1;
+    }
+    bn_mul_fixed(p1, ones, ones, n);
+    mul_rows(p2, ones, ones, n);
+    if (memcmp(p1, p2, 2 * n * sizeof(u64))) {
+        return -1;
+    }
+
+    bn_sqr_fixed(p1, a, n);
+    sqr_rows(p2, a, n);
+    if (memcmp(p1, p2, 2 * n * sizeof(u64))) {
+        return -1;
+    }
+    bn_sqr_fixed(p1, ones, n);
+    sqr_rows(p2, ones, n);
+    if (memcmp(p1, p2, 2 * n * sizeof(u64))) {
+        return -1;
+    }
+
+    return 0;
+}
+
+/* keeps the compiler from dropping the calls */
+static volatile u64 sink;
+
+#define TIME(expr)                                          \
+    ({                                                      \
+        long calls = WORK / n;                              \
+        u64 c = 0;                                          \
+        double start = now_ns();                            \
+        for (long i = 0; i < calls; ++i) {                  \
+            c += (expr);                                    \
+        }                                                   \
+        sink = c;                                           \
+        (now_ns() - start) / ((double) calls * n);          \
+    })
+
+/* the time of one product, in nanoseconds */
+#define TIME_PRODUCT(stmt)                                  \
+    ({                                                      \
+        long calls = WORK / (n * n);                        \
+        double start = now_ns();                            \
+        for (long i = 0; i < calls; ++i) {                  \
+            stmt;                                           \
+            sink = r1[i & 7];                               \
+        }                                                   \
+        (now_ns() - start) / calls;                         \
+    })
+
+static int bench_mul(void)
+{
+    for (long n = 1; n <= BN_FIXED_MAX; ++n) {
+        if (check_mul(n)) {
+            printf("FAIL: fixed width kernels disagree at %ld limbs\n", n);
+            return 1;
+        }
+    }
+
+    for (long n = 1; n <= BN_FIXED_MAX; ++n) {
+        double mul = TIME_PRODUCT(bn_mul_fixed(r1, a, b, n));
+        double mul_rows_ns = TIME_PRODUCT(mul_rows(r1, a, b, n));
+        double sqr = TIME_PRODUCT(bn_sqr_fixed(r1, a, n));
+        double sqr_rows_ns = TIME_PRODUCT(sqr_rows(r1, a, n));
+        printf("%ld %.1f %.1f %.1f %.1f\n", n, mul, mul_rows_ns, sqr, sqr_rows_ns);
+    }
+
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    for (int i = 0; i < MAX_LIMBS; ++i) {
+        a[i] = rand64();
+        b[i] = rand64();
+    }
+
+    if (argc > 1 && strcmp(argv[1], "mul") == 0) {
+        return bench_mul();
+    }
+
+    /* every length up to 64 for the tails, then some long ones */
+    for (long n = 1; n <= MAX_LIMBS; n = n < 64 ? n + 1 : n * 2) {
+        if (check(n)) {
+            printf("FAIL: kernels disagree at %ld limbs\n", n);
+            return 1;
+        }
+    }
+
+    for (long n = 1; n <= MAX_LIMBS; n *= 2) {
+        double add = TIME(bn_add_n(r1, a, b, n));
+        double add_generic = TIME(bn_add_n_generic(r1, a, b, n, 0));
+        double sub = TIME(bn_sub_n(r1, a, b, n));
+        double sub_generic = TIME(bn_sub_n_generic(r1, a, b, n, 0));
+        printf("%ld %.3f %.3f %.3f %.3f\n", n, add, add_generic, sub, sub_generic);
+    }
+
+    return 0;
+}
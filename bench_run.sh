@@ -0,0 +1,176 @@
+#!/bin/bash
+# run a timing client on an isolated CPU and restore the machine afterwards
+#
+# usage: sudo ./bench_run.sh [-c cpu] [-o outdir] [-n max runs] [-v cv %] [command ...]
+#
+# Before the runs the chosen CPU gets an isolated cpuset partition, the IRQs
+# move to the other CPUs, its SMT sibling goes offline, turbo and ASLR are
+# turned off, performance.sh sets the governors, and the page cache is
+# dropped. The command (default ./get_time) then runs under taskset on that
+# CPU until the wall time of the last 3 runs varies by less than the cv
+# target, or the max runs are used up. Every output goes to outdir/run-N.txt,
+# next to env.txt describing the host and the settings, so runs on
+# different hosts can be compared. Everything is put back on exit.
+
+CPU=$(($(nproc --all) - 1))
+OUT=bench-$(date +%Y%m%d-%H%M%S)
+MAX_RUNS=10
+CV_TARGET=2
+
+while getopts "c:o:n:v:" opt
+do
+    case $opt in
+    c) CPU=$OPTARG ;;
+    o) OUT=$OPTARG ;;
+    n) MAX_RUNS=$OPTARG ;;
+    v) CV_TARGET=$OPTARG ;;
+    *) echo "usage: $0 [-c cpu] [-o outdir] [-n max runs] [-v cv %] [command ...]" >&2
+       exit 1 ;;
+    esac
+done
+shift $((OPTIND - 1))
+[ $# -eq 0 ] && set -- ./get_time
+
+if [ "$(id -u)" -ne 0 ]; then
+    echo "$0 needs root" >&2
+    exit 1
+fi
+
+SYS=/sys/devices/system/cpu
+CGROUP=/sys/fs/cgroup/fibbench
+mkdir -p "$OUT"
+
+# saved settings, written back by restore()
+declare -A IRQ_SAVED GOV_SAVED
+SIBLINGS=""
+NO_TURBO_SAVED=""
+BOOST_SAVED=""
+CPUSET_ADDED=""
+ASLR_SAVED=$(cat /proc/sys/kernel/randomize_va_space)
+
+restore()
+{
+    for irq in "${!IRQ_SAVED[@]}"
+    do
+        echo "${IRQ_SAVED[$irq]}" > /proc/irq/$irq/smp_affinity_list 2> /dev/null
+    done
+    for s in $SIBLINGS
+    do
+        echo 1 > $SYS/cpu$s/online
+    done
+    [ -n "$NO_TURBO_SAVED" ] && echo $NO_TURBO_SAVED > $SYS/intel_pstate/no_turbo
+    [ -n "$BOOST_SAVED" ] && echo $BOOST_SAVED > $SYS/cpufreq/boost
+    for g in "${!GOV_SAVED[@]}"
+    do
+        echo "${GOV_SAVED[$g]}" > $g 2> /dev/null
+    done
+    echo $ASLR_SAVED > /proc/sys/kernel/randomize_va_space
+    if [ -d $CGROUP ]; then
+        # the shell itself sits in the cgroup, step out before removing it
+        echo $$ > /sys/fs/cgroup/cgroup.procs
+        rmdir $CGROUP
+    fi
+    [ -n "$CPUSET_ADDED" ] && echo -cpuset > /sys/fs/cgroup/cgroup.subtree_control
+}
+trap restore EXIT
+
+# SMT siblings of the CPU go offline, the CPU itself stays
+# the list is like "0,4" or "0-3", ranges are expanded
+for s in $(tr ',' '\n' < $SYS/cpu$CPU/topology/thread_siblings_list |
+           while IFS=- read lo hi; do seq $lo ${hi:-$lo}; done)
+do
+    if [ $s -ne $CPU ] && [ -e $SYS/cpu$s/online ]; then
+        echo 0 > $SYS/cpu$s/online && SIBLINGS="$SIBLINGS $s"
+    fi
+done
+
+# an isolated cpuset partition: no other task is scheduled on the CPU
+if [ -e /sys/fs/cgroup/cgroup.subtree_control ]; then
+    if ! grep -qw cpuset /sys/fs/cgroup/cgroup.subtree_control; then
+        echo +cpuset > /sys/fs/cgroup/cgroup.subtree_control && CPUSET_ADDED=1
+    fi
+    mkdir -p $CGROUP
+    echo $CPU > $CGROUP/cpuset.cpus
+    echo isolated > $CGROUP/cpuset.cpus.partition 2> /dev/null ||
+        echo root > $CGROUP/cpuset.cpus.partition 2> /dev/null
+    echo $$ > $CGROUP/cgroup.procs
+fi
+
+# IRQs go everywhere but the CPU
+OTHERS=$(seq -s, 0 $(($(nproc --all) - 1)) | tr ',' '\n' | grep -vx $CPU | paste -sd,)
+for f in /proc/irq/*/smp_affinity_list
+do
+    irq=$(basename $(dirname $f))
+    IRQ_SAVED[$irq]=$(cat $f)
+    echo $OTHERS > $f 2> /dev/null
+done
+
+# turbo off, through intel_pstate or the generic boost switch
+if [ -e $SYS/intel_pstate/no_turbo ]; then
+    NO_TURBO_SAVED=$(cat $SYS/intel_pstate/no_turbo)
+    echo 1 > $SYS/intel_pstate/no_turbo
+elif [ -e $SYS/cpufreq/boost ]; then
+    BOOST_SAVED=$(cat $SYS/cpufreq/boost)
+    echo 0 > $SYS/cpufreq/boost
+fi
+
+for g in $SYS/cpu*/cpufreq/scaling_governor
+do
+    [ -e $g ] && GOV_SAVED[$g]=$(cat $g)
+done
+./performance.sh 2> /dev/null
+
+echo 0 > /proc/sys/kernel/randomize_va_space
+
+sync
+echo 3 > /proc/sys/vm/drop_caches
+
+{
+    echo "date: $(date -Is)"
+    echo "host: $(hostname)"
+    echo "kernel: $(uname -r)"
+    echo "cpu model: $(grep -m1 'model name' /proc/cpuinfo | cut -d: -f2 | sed 's/^ //')"
+    echo "microcode: $(grep -m1 microcode /proc/cpuinfo | cut -d: -f2 | sed 's/^ //')"
+    echo "bench cpu: $CPU"
+    echo "node: $(basename $(ls -d $SYS/cpu$CPU/node* 2> /dev/null) 2> /dev/null)"
+    echo "siblings offline: ${SIBLINGS:-none}"
+    echo "cpuset partition: $(cat $CGROUP/cpuset.cpus.partition 2> /dev/null || echo none)"
+    echo "governor: $(cat $SYS/cpu$CPU/cpufreq/scaling_governor 2> /dev/null)"
+    echo "frequency (kHz): $(cat $SYS/cpu$CPU/cpufreq/scaling_cur_freq 2> /dev/null)"
+    echo "no_turbo: $(cat $SYS/intel_pstate/no_turbo 2> /dev/null)"
+    echo "boost: $(cat $SYS/cpufreq/boost 2> /dev/null)"
+    echo "aslr: $(cat /proc/sys/kernel/randomize_va_space)"
+    echo "fibdrv: $(git rev-parse --short HEAD 2> /dev/null)"
+    for p in /sys/module/fibdrv/parameters/*
+    do
+        [ -e $p ] && echo "fibdrv $(basename $p): $(cat $p)"
+    done
+    echo "command: $*"
+} > "$OUT/env.txt"
+
+# run until the last 3 wall times agree within the cv target
+times=()
+for run in $(seq 1 $MAX_RUNS)
+do
+    start=$(date +%s%N)
+    taskset -c $CPU "$@" > "$OUT/run-$run.txt"
+    times+=($(( $(date +%s%N) - start )))
+
+    if [ $run -ge 3 ]; then
+        cv=$(printf '%s\n' "${times[@]: -3}" |
+             awk '{ s += $1; q += $1 * $1 } END { m = s / NR; printf "%.2f", sqrt(q / NR - m * m) / m * 100 }')
+        echo "run $run: ${times[-1]} ns, cv of the last 3 runs $cv%" >&2
+        if awk -v cv=$cv -v t=$CV_TARGET 'BEGIN { exit !(cv < t) }'; then
+            break
+        fi
+    else
+        echo "run $run: ${times[-1]} ns" >&2
+    fi
+done
+
+{
+    echo "runs: ${#times[@]}"
+    echo "wall times (ns): ${times[*]}"
+    echo "cv of the last 3 runs: ${cv:-n/a}%"
+} >> "$OUT/env.txt"
+echo "results in $OUT" >&2
@@ -0,0 +1,407 @@
+#ifndef BN_KERNELS_H
+#define BN_KERNELS_H
+
+/*
+ * add/sub kernels of the limb arithmetic
+ *
+ * r[0 .. n) = a +/- b over n little-endian 64-bit limbs, returning the carry
+ * (or borrow) out of the top limb. On x86-64 and arm64 the carry stays in the
+ * flags register for the whole run: four limbs per iteration with adc/sbb or
+ * adcs/sbcs, and pointer and counter updates that leave the flags alone.
+ * Elsewhere, and for the last n % 4 limbs, the portable versions compute the
+ * carry with comparisons, which compile to setc/sbb rather than branches.
+ *
+ * r may be the same array as a or b. Header only, so the module and the
+ * userspace benchmark (bench_kernels.c) run the very same code.
+ */
+
+#ifdef __KERNEL__
+#include <linux/types.h>
+#else
+#include <stdint.h>
+typedef uint64_t u64;
+#endif
+
+#if defined(__x86_64__) || defined(__aarch64__)
+#define BN_HAVE_ASM 1
+#else
+#define BN_HAVE_ASM 0
+#endif
+
+/* one limb of r = a + b + carry, carry is 0 or 1 */
+#define BN_ADD_STEP(i)                  \
+    do {                                \
+        u64 s = a[i] + carry;           \
+        carry = s < carry;              \
+        u64 t = s + b[i];               \
+        carry += t < s;                 \
+        r[i] = t;                       \
+    } while (0)
+
+/* one limb of r = a - b - borrow, borrow is 0 or 1 */
+#define BN_SUB_STEP(i)                  \
+    do {                                \
+        u64 s = a[i] - borrow;          \
+        borrow = s > a[i];              \
+        borrow += s < b[i];             \
+        r[i] = s - b[i];                \
+    } while (0)
+
+static inline u64 bn_add_n_generic(u64 *r, const u64 *a, const u64 *b, long n, u64 carry)
+{
+    long i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        BN_ADD_STEP(i);
+        BN_ADD_STEP(i + 1);
+        BN_ADD_STEP(i + 2);
+        BN_ADD_STEP(i + 3);
+    }
+    for (; i < n; ++i) {
+        BN_ADD_STEP(i);
+    }
+
+    return carry;
+}
+
+static inline u64 bn_sub_n_generic(u64 *r, const u64 *a, const u64 *b, long n, u64 borrow)
+{
+    long i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        BN_SUB_STEP(i);
+        BN_SUB_STEP(i + 1);
+        BN_SUB_STEP(i + 2);
+        BN_SUB_STEP(i + 3);
+    }
+    for (; i < n; ++i) {
+        BN_SUB_STEP(i);
+    }
+
+    return borrow;
+}
+
+/* r = a + b, return the carry out */
+static inline u64 bn_add_n(u64 *r, const u64 *a, const u64 *b, long n)
+{
+#if BN_HAVE_ASM
+    long blocks = n >> 2;
+    u64 carry = 0;
+
+    if (blocks) {
+#if defined(__x86_64__)
+        /* xor clears CF; lea and dec leave it alone */
+        asm("xorl %k[c], %k[c]\n\t"
+            "1:\n\t"
+            "movq (%[a]), %%r8\n\t"
+            "movq 8(%[a]), %%r9\n\t"
+            "movq 16(%[a]), %%r10\n\t"
+            "movq 24(%[a]), %%r11\n\t"
+            "adcq (%[b]), %%r8\n\t"
+            "adcq 8(%[b]), %%r9\n\t"
+            "adcq 16(%[b]), %%r10\n\t"
+            "adcq 24(%[b]), %%r11\n\t"
+            "movq %%r8, (%[r])\n\t"
+            "movq %%r9, 8(%[r])\n\t"
+            "movq %%r10, 16(%[r])\n\t"
+            "movq %%r11, 24(%[r])\n\t"
+            "leaq 32(%[a]), %[a]\n\t"
+            "leaq 32(%[b]), %[b]\n\t"
+            "leaq 32(%[r]), %[r]\n\t"
+            "decq %[n]\n\t"
+            "jnz 1b\n\t"
+            "adcl $0, %k[c]"
+            : [r] "+r"(r), [a] "+r"(a), [b] "+r"(b), [n] "+r"(blocks), [c] "=&r"(carry)
+            :
+            : "r8", "r9", "r10", "r11", "cc", "memory");
+#else
+        /* cmn xzr, xzr clears C; sub and cbnz leave it alone */
+        asm("cmn xzr, xzr\n\t"
+            "1:\n\t"
+            "ldp x8, x9, [%[a]], #16\n\t"
+            "ldp x10, x11, [%[a]], #16\n\t"
+            "ldp x12, x13, [%[b]], #16\n\t"
+            "ldp x14, x15, [%[b]], #16\n\t"
+            "adcs x8, x8, x12\n\t"
+            "adcs x9, x9, x13\n\t"
+            "adcs x10, x10, x14\n\t"
+            "adcs x11, x11, x15\n\t"
+            "stp x8, x9, [%[r]], #16\n\t"
+            "stp x10, x11, [%[r]], #16\n\t"
+            "sub %[n], %[n], #1\n\t"
+            "cbnz %[n], 1b\n\t"
+            "cset %[c], cs"
+            : [r] "+r"(r), [a] "+r"(a), [b] "+r"(b), [n] "+r"(blocks), [c] "=r"(carry)
+            :
+            : "x8", "x9", "x10", "x11", "x12", "x13", "x14", "x15", "cc", "memory");
+#endif
+    }
+
+    return bn_add_n_generic(r, a, b, n & 3, carry);
+#else
+    return bn_add_n_generic(r, a, b, n, 0);
+#endif
+}
+
+/* r = a - b, return the borrow out */
+static inline u64 bn_sub_n(u64 *r, const u64 *a, const u64 *b, long n)
+{
+#if BN_HAVE_ASM
+    long blocks = n >> 2;
+    u64 borrow = 0;
+
+    if (blocks) {
+#if defined(__x86_64__)
+        asm("xorl %k[c], %k[c]\n\t"
+            "1:\n\t"
+            "movq (%[a]), %%r8\n\t"
+            "movq 8(%[a]), %%r9\n\t"
+            "movq 16(%[a]), %%r10\n\t"
+            "movq 24(%[a]), %%r11\n\t"
+            "sbbq (%[b]), %%r8\n\t"
+            "sbbq 8(%[b]), %%r9\n\t"
+            "sbbq 16(%[b]), %%r10\n\t"
+            "sbbq 24(%[b]), %%r11\n\t"
+            "movq %%r8, (%[r])\n\t"
+            "movq %%r9, 8(%[r])\n\t"
+            "movq %%r10, 16(%[r])\n\t"
+            "movq %%r11, 24(%[r])\n\t"
+            "leaq 32(%[a]), %[a]\n\t"
+            "leaq 32(%[b]), %[b]\n\t"
+            "leaq 32(%[r]), %[r]\n\t"
+            "decq %[n]\n\t"
+            "jnz 1b\n\t"
+            "adcl $0, %k[c]"
+            : [r] "+r"(r), [a] "+r"(a), [b] "+r"(b), [n] "+r"(blocks), [c] "=&r"(borrow)
+            :
+            : "r8", "r9", "r10", "r11", "cc", "memory");
+#else
+        /* on arm64 C means "no borrow", cmp xzr, xzr sets it */
+        asm("cmp xzr, xzr\n\t"
+            "1:\n\t"
+            "ldp x8, x9, [%[a]], #16\n\t"
+            "ldp x10, x11, [%[a]], #16\n\t"
+            "ldp x12, x13, [%[b]], #16\n\t"
+            "ldp x14, x15, [%[b]], #16\n\t"
+            "sbcs x8, x8, x12\n\t"
+            "sbcs x9, x9, x13\n\t"
+            "sbcs x10, x10, x14\n\t"
+            "sbcs x11, x11, x15\n\t"
+            "stp x8, x9, [%[r]], #16\n\t"
+            "stp x10, x11, [%[r]], #16\n\t"
+            "sub %[n], %[n], #1\n\t"
+            "cbnz %[n], 1b\n\t"
+            "cset %[c], cc"
+            : [r] "+r"(r), [a] "+r"(a), [b] "+r"(b), [n] "+r"(blocks), [c] "=r"(borrow)
+            :
+            : "x8", "x9", "x10", "x11", "x12", "x13", "x14", "x15", "cc", "memory");
+#endif
+    }
+
+    return bn_sub_n_generic(r, a, b, n & 3, borrow);
+#else
+    return bn_sub_n_generic(r, a, b, n, 0);
+#endif
+}
+
+/* r = a + c over n limbs, c may be any value, return the carry out */
+static inline u64 bn_add_1(u64 *r, const u64 *a, long n, u64 c)
+{
+    for (long i = 0; i < n; ++i) {
+        u64 s = a[i] + c;
+        c = s < c;
+        r[i] = s;
+    }
+    return c;
+}
+
+/* r = a - c over n limbs, c may be any value, return the borrow out */
+static inline u64 bn_sub_1(u64 *r, const u64 *a, long n, u64 c)
+{
+    for (long i = 0; i < n; ++i) {
+        u64 s = a[i] - c;
+        c = s > a[i];
+        r[i] = s;
+    }
+    return c;
+}
+
+/*
+ * fixed width multiplication and squaring
+ *
+ * Products of up to BN_FIXED_MAX limbs a side (2048-bit results, F(2950) or
+ * so) are straight line code of exactly that width, one instance of the
+ * templates below per width, and the dispatchers pick the instance at
+ * runtime. They go column by column (Comba): every partial product of a
+ * column is added into three accumulator limbs that stay in registers, and
+ * each result limb is stored once, where the row by row loop carries
+ * through memory on every step. Wider operands take the loop.
+ *
+ * r must not overlap a or b.
+ */
+#define BN_FIXED_MAX 16
+
+/* (c2, c1, c0) += x * y */
+#define BN_MAC(x, y)                                                  \
+    do {                                                              \
+        unsigned __int128 t = (unsigned __int128) (x) * (y);          \
+        unsigned __int128 s = (((unsigned __int128) c1 << 64) | c0) + t; \
+        c2 += s < t;                                                  \
+        c0 = (u64) s;                                                 \
+        c1 = (u64) (s >> 64);                                         \
+    } while (0)
+
+/* the product a[i] * b[k - i] of column k, if it is one */
+#define BN_MUL_TERM(i, k, N)                    \
+    do {                                        \
+        if ((i) <= (k) && (k) - (i) < (N)) {    \
+            BN_MAC(a[i], b[(k) - (i)]);         \
+        }                                       \
+    } while (0)
+
+/* the cross product a[i] * a[k - i] of column k of a square, i < k - i */
+#define BN_SQR_TERM(i, k, N)                        \
+    do {                                            \
+        if ((i) < (k) - (i) && (k) - (i) < (N)) {   \
+            BN_MAC(a[i], a[(k) - (i)]);             \
+        }                                           \
+    } while (0)
+
+/* column k of the product, into r[k] */
+#define BN_MUL_COLUMN(k, N)                     \
+    do {                                        \
+        BN_REPI##N(BN_MUL_TERM, 0, k, N);       \
+        r[k] = c0;                              \
+        c0 = c1;                                \
+        c1 = c2;                                \
+        c2 = 0;                                 \
+    } while (0)
+
+/*
+ * a[i] * a[j] and a[j] * a[i] are the same, so a column of a square sums
+ * the products with i < j, doubles them, and adds what the columns before
+ * carried in and the square on the diagonal
+ */
+#define BN_SQR_COLUMN(k, N)                                                   \
+    do {                                                                      \
+        unsigned __int128 in = ((unsigned __int128) c1 << 64) | c0;           \
+        c0 = c1 = c2 = 0;                                                     \
+        BN_REPI##N(BN_SQR_TERM, 0, k, N);                                     \
+        c2 = (c2 << 1) | (c1 >> 63);                                          \
+        c1 = (c1 << 1) | (c0 >> 63);                                          \
+        c0 <<= 1;                                                             \
+        unsigned __int128 sum = (((unsigned __int128) c1 << 64) | c0) + in;   \
+        c2 += sum < in;                                                       \
+        c0 = (u64) sum;                                                       \
+        c1 = (u64) (sum >> 64);                                               \
+        if (((k) & 1) == 0 && (k) / 2 < (N)) {                                \
+            BN_MAC(a[(k) / 2], a[(k) / 2]);                                   \
+        }                                                                     \
+        r[k] = c0;                                                            \
+        c0 = c1;                                                              \
+        c1 = c2;                                                              \
+        c2 = 0;                                                               \
+    } while (0)
+
+/* S(i, ...); S(i + 1, ...); ... n times, K for the columns, I for the terms */
+#define BN_REPK1(S, i, ...) S(i, __VA_ARGS__)
+#define BN_REPK2(S, i, ...) BN_REPK1(S, i, __VA_ARGS__); S((i) + 1, __VA_ARGS__)
+#define BN_REPK3(S, i, ...) BN_REPK2(S, i, __VA_ARGS__); S((i) + 2, __VA_ARGS__)
+#define BN_REPK4(S, i, ...) BN_REPK3(S, i, __VA_ARGS__); S((i) + 3, __VA_ARGS__)
+#define BN_REPK5(S, i, ...) BN_REPK4(S, i, __VA_ARGS__); S((i) + 4, __VA_ARGS__)
+#define BN_REPK6(S, i, ...) BN_REPK5(S, i, __VA_ARGS__); S((i) + 5, __VA_ARGS__)
+#define BN_REPK7(S, i, ...) BN_REPK6(S, i, __VA_ARGS__); S((i) + 6, __VA_ARGS__)
+#define BN_REPK8(S, i, ...) BN_REPK7(S, i, __VA_ARGS__); S((i) + 7, __VA_ARGS__)
+#define BN_REPK9(S, i, ...) BN_REPK8(S, i, __VA_ARGS__); S((i) + 8, __VA_ARGS__)
+#define BN_REPK10(S, i, ...) BN_REPK9(S, i, __VA_ARGS__); S((i) + 9, __VA_ARGS__)
+#define BN_REPK11(S, i, ...) BN_REPK10(S, i, __VA_ARGS__); S((i) + 10, __VA_ARGS__)
+#define BN_REPK12(S, i, ...) BN_REPK11(S, i, __VA_ARGS__); S((i) + 11, __VA_ARGS__)
+#define BN_REPK13(S, i, ...) BN_REPK12(S, i, __VA_ARGS__); S((i) + 12, __VA_ARGS__)
+#define BN_REPK14(S, i, ...) BN_REPK13(S, i, __VA_ARGS__); S((i) + 13, __VA_ARGS__)
+#define BN_REPK15(S, i, ...) BN_REPK14(S, i, __VA_ARGS__); S((i) + 14, __VA_ARGS__)
+#define BN_REPK16(S, i, ...) BN_REPK15(S, i, __VA_ARGS__); S((i) + 15, __VA_ARGS__)
+#define BN_REPK17(S, i, ...) BN_REPK16(S, i, __VA_ARGS__); S((i) + 16, __VA_ARGS__)
+#define BN_REPK18(S, i, ...) BN_REPK17(S, i, __VA_ARGS__); S((i) + 17, __VA_ARGS__)
+#define BN_REPK19(S, i, ...) BN_REPK18(S, i, __VA_ARGS__); S((i) + 18, __VA_ARGS__)
+#define BN_REPK20(S, i, ...) BN_REPK19(S, i, __VA_ARGS__); S((i) + 19, __VA_ARGS__)
+#define BN_REPK21(S, i, ...) BN_REPK20(S, i, __VA_ARGS__); S((i) + 20, __VA_ARGS__)
+#define BN_REPK22(S, i, ...) BN_REPK21(S, i, __VA_ARGS__); S((i) + 21, __VA_ARGS__)
+#define BN_REPK23(S, i, ...) BN_REPK22(S, i, __VA_ARGS__); S((i) + 22, __VA_ARGS__)
+#define BN_REPK24(S, i, ...) BN_REPK23(S, i, __VA_ARGS__); S((i) + 23, __VA_ARGS__)
+#define BN_REPK25(S, i, ...) BN_REPK24(S, i, __VA_ARGS__); S((i) + 24, __VA_ARGS__)
+#define BN_REPK26(S, i, ...) BN_REPK25(S, i, __VA_ARGS__); S((i) + 25, __VA_ARGS__)
+#define BN_REPK27(S, i, ...) BN_REPK26(S, i, __VA_ARGS__); S((i) + 26, __VA_ARGS__)
+#define BN_REPK28(S, i, ...) BN_REPK27(S, i, __VA_ARGS__); S((i) + 27, __VA_ARGS__)
+#define BN_REPK29(S, i, ...) BN_REPK28(S, i, __VA_ARGS__); S((i) + 28, __VA_ARGS__)
+#define BN_REPK30(S, i, ...) BN_REPK29(S, i, __VA_ARGS__); S((i) + 29, __VA_ARGS__)
+#define BN_REPK31(S, i, ...) BN_REPK30(S, i, __VA_ARGS__); S((i) + 30, __VA_ARGS__)
+
+#define BN_REPI1(S, i, ...) S(i, __VA_ARGS__)
+#define BN_REPI2(S, i, ...) BN_REPI1(S, i, __VA_ARGS__); S((i) + 1, __VA_ARGS__)
+#define BN_REPI3(S, i, ...) BN_REPI2(S, i, __VA_ARGS__); S((i) + 2, __VA_ARGS__)
+#define BN_REPI4(S, i, ...) BN_REPI3(S, i, __VA_ARGS__); S((i) + 3, __VA_ARGS__)
+#define BN_REPI5(S, i, ...) BN_REPI4(S, i, __VA_ARGS__); S((i) + 4, __VA_ARGS__)
+#define BN_REPI6(S, i, ...) BN_REPI5(S, i, __VA_ARGS__); S((i) + 5, __VA_ARGS__)
+#define BN_REPI7(S, i, ...) BN_REPI6(S, i, __VA_ARGS__); S((i) + 6, __VA_ARGS__)
+#define BN_REPI8(S, i, ...) BN_REPI7(S, i, __VA_ARGS__); S((i) + 7, __VA_ARGS__)
+#define BN_REPI9(S, i, ...) BN_REPI8(S, i, __VA_ARGS__); S((i) + 8, __VA_ARGS__)
+#define BN_REPI10(S, i, ...) BN_REPI9(S, i, __VA_ARGS__); S((i) + 9, __VA_ARGS__)
+#define BN_REPI11(S, i, ...) BN_REPI10(S, i, __VA_ARGS__); S((i) + 10, __VA_ARGS__)
+#define BN_REPI12(S, i, ...) BN_REPI11(S, i, __VA_ARGS__); S((i) + 11, __VA_ARGS__)
+#define BN_REPI13(S, i, ...) BN_REPI12(S, i, __VA_ARGS__); S((i) + 12, __VA_ARGS__)
+#define BN_REPI14(S, i, ...) BN_REPI13(S, i, __VA_ARGS__); S((i) + 13, __VA_ARGS__)
+#define BN_REPI15(S, i, ...) BN_REPI14(S, i, __VA_ARGS__); S((i) + 14, __VA_ARGS__)
+#define BN_REPI16(S, i, ...) BN_REPI15(S, i, __VA_ARGS__); S((i) + 15, __VA_ARGS__)
+
+/* r[0 .. 2N) = a[0 .. N) * b[0 .. N), and r[0 .. 2N) = a[0 .. N)^2 */
+#define BN_DEFINE_FIXED(N, COLUMNS)                                        \
+    static inline void bn_mul_fixed##N(u64 *r, const u64 *a, const u64 *b) \
+    {                                                                      \
+        u64 c0 = 0, c1 = 0, c2 = 0;                                        \
+        BN_REPK##COLUMNS(BN_MUL_COLUMN, 0, N);                             \
+        r[2 * (N) - 1] = c0;                                               \
+    }                                                                      \
+    static inline void bn_sqr_fixed##N(u64 *r, const u64 *a)               \
+    {                                                                      \
+        u64 c0 = 0, c1 = 0, c2 = 0;                                        \
+        BN_REPK##COLUMNS(BN_SQR_COLUMN, 0, N);                             \
+        r[2 * (N) - 1] = c0;                                               \
+    }
+
+/* X(width, columns but the top one) for every width up to BN_FIXED_MAX */
+#define BN_FIXED_WIDTHS(X)                                                  \
+    X(1, 1) X(2, 3) X(3, 5) X(4, 7) X(5, 9) X(6, 11) X(7, 13) X(8, 15)      \
+    X(9, 17) X(10, 19) X(11, 21) X(12, 23) X(13, 25) X(14, 27) X(15, 29)    \
+    X(16, 31)
+
+BN_FIXED_WIDTHS(BN_DEFINE_FIXED)
+
+/* r[0 .. 2n) = a[0 .. n) * b[0 .. n), return 0 if n is too wide for it */
+static inline int bn_mul_fixed(u64 *r, const u64 *a, const u64 *b, long n)
+{
+#define BN_CASE(N, COLUMNS)             \
+    case N:                             \
+        bn_mul_fixed##N(r, a, b);       \
+        return 1;
+    switch (n) {
+        BN_FIXED_WIDTHS(BN_CASE)
+    }
+#undef BN_CASE
+    return 0;
+}
+
+/* r[0 .. 2n) = a[0 .. n)^2, return 0 if n is too wide for it */
+static inline int bn_sqr_fixed(u64 *r, const u64 *a, long n)
+{
+#define BN_CASE(N, COLUMNS)             \
+    case N:                             \
+        bn_sqr_fixed##N(r, a);          \
+        return 1;
+    switch (n) {
+        BN_FIXED_WIDTHS(BN_CASE)
+    }
+#undef BN_CASE
+    return 0;
+}
+
+#endif /* BN_KERNELS_H */
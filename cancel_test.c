@@ -0,0 +1,84 @@
+/* cancel_test.c */
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define FIB_DEV "/dev/fibonacci"
+#define BUFFER_SIZE (1 << 20)
+/*
+ * big enough to keep bignum_bin_fibonacci busy for minutes
+ * load the module with "insmod fibdrv.ko max_index=1000000" so lseek accepts it
+ */
+#define INDEX 1000000
+#define MODE 4
+#define RUN_BEFORE_SIGNAL_MS 1000
+/* how long the killed read may take to return */
+#define MAX_EXIT_MS 200
+
+static long long elapsed_ms(struct timespec *start, struct timespec *end)
+{
+    return (end->tv_sec - start->tv_sec) * 1000 + (end->tv_nsec - start->tv_nsec) / 1000000;
+}
+
+int main()
+{
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        exit(1);
+    }
+
+    if (pid == 0) {
+        /* child: one huge read, Ctrl-C (SIGINT) is delivered while it runs */
+        char *buf = malloc(BUFFER_SIZE);
+        int fd = open(FIB_DEV, O_RDWR);
+        if (fd < 0 || !buf) {
+            perror("Failed to open character device");
+            exit(2);
+        }
+        if (lseek(fd, INDEX, SEEK_SET) != INDEX) {
+            printf("lseek stopped short of %d, raise max_index\n", INDEX);
+            exit(3);
+        }
+        read(fd, buf, MODE);
+        close(fd);
+        exit(0);
+    }
+
+    struct timespec start, signalled, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    usleep(RUN_BEFORE_SIGNAL_MS * 1000);
+
+    int status;
+    if (waitpid(pid, &status, WNOHANG) == pid) {
+        printf("FAIL: the read finished before it could be interrupted (status %d)\n",
+               WIFEXITED(status) ? WEXITSTATUS(status) : -1);
+        return 1;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &signalled);
+    kill(pid, SIGINT);
+    waitpid(pid, &status, 0);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    long long exit_ms = elapsed_ms(&signalled, &end);
+    printf("read ran %lld ms, returned %lld ms after SIGINT\n", elapsed_ms(&start, &signalled),
+           exit_ms);
+
+    if (!WIFSIGNALED(status) || WTERMSIG(status) != SIGINT) {
+        printf("FAIL: the reader was not terminated by SIGINT\n");
+        return 1;
+    }
+    if (exit_ms > MAX_EXIT_MS) {
+        printf("FAIL: took longer than %d ms\n", MAX_EXIT_MS);
+        return 1;
+    }
+
+    printf("PASS\n");
+    return 0;
+}
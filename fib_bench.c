@@ -0,0 +1,384 @@
+/* fib_bench.c */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * Load generator for /dev/fibonacci.
+ *
+ * For every thread count in the sweep, the threads wait on a barrier, then
+ * issue pread(fd, buf, mode, k) back to back for the given duration while
+ * each request is timed on its own. Thread creation is not measured.
+ * One CSV row per thread count goes to stdout:
+ *
+ *   threads,mode,dist,requests,errors,seconds,qps,p50_ns,p90_ns,p99_ns,p999_ns,max_ns
+ *
+ * usage: fib_bench [-t 1,2,4,8] [-c cpu,cpu,...] [-m mode] [-d uniform|zipf|fixed]
+ *                  [-n max index] [-k fixed index] [-s zipf exponent]
+ *                  [-T seconds] [-p]
+ *
+ *   -c  pin thread i to the i-th cpu of the list (round robin), default unpinned
+ *   -p  every thread opens its own file instead of sharing one
+ *       (the driver currently allows a single open, so this needs -t 1)
+ *
+ * link with -lpthread -lm
+ */
+
+#define FIB_DEV "/dev/fibonacci"
+#define MAX_THREADS 256
+#define MAX_CPUS 1024
+
+/* log-linear latency histogram, 16 sub-buckets per power of two (~6% error) */
+#define HIST_SUB_BITS 4
+#define HIST_SUB (1 << HIST_SUB_BITS)
+#define HIST_BUCKETS ((64 - HIST_SUB_BITS + 1) * HIST_SUB)
+
+enum dist { DIST_UNIFORM, DIST_ZIPF, DIST_FIXED };
+static const char *dist_name[] = {"uniform", "zipf", "fixed"};
+
+static struct {
+    int mode;
+    enum dist dist;
+    int max_index;
+    int fixed_index;
+    double zipf_s;
+    int seconds;
+    int private_fd;
+    int cpus[MAX_CPUS];
+    int nr_cpus;
+} opt = {
+    .mode = 1,
+    .dist = DIST_UNIFORM,
+    .max_index = 100,
+    .fixed_index = 100,
+    .zipf_s = 0.99,
+    .seconds = 5,
+};
+
+/* cumulative distribution of the zipf ranks 0 ~ max_index */
+static double *zipf_cdf;
+
+static int shared_fd = -1;
+static volatile int stop;
+static pthread_barrier_t barrier;
+
+typedef struct bench_thread {
+    int thread_id;
+    pthread_t thread;
+    uint64_t rng;
+    long long requests;
+    long long errors;
+    uint64_t max_ns;
+    uint64_t hist[HIST_BUCKETS];
+} bench_thread;
+
+static bench_thread threads[MAX_THREADS];
+
+static int hist_bucket(uint64_t v)
+{
+    if (v < HIST_SUB) {
+        return v;
+    }
+    int msb = 63 - __builtin_clzll(v);
+
+    return (msb - HIST_SUB_BITS + 1) * HIST_SUB + ((v >> (msb - HIST_SUB_BITS)) & (HIST_SUB - 1));
+}
+
+/* the smallest value that falls into bucket @b */
+static uint64_t hist_value(int b)
+{
+    if (b < HIST_SUB) {
+        return b;
+    }
+    int msb = b / HIST_SUB + HIST_SUB_BITS - 1;
+
+    return (uint64_t)(HIST_SUB + b % HIST_SUB) << (msb - HIST_SUB_BITS);
+}
+
+static uint64_t hist_percentile(const uint64_t *hist, long long total, double p)
+{
+    long long rank = (long long) ceil(total * p);
+    long long seen = 0;
+
+    for (int b = 0; b < HIST_BUCKETS; ++b) {
+        seen += hist[b];
+        if (seen >= rank && seen > 0) {
+            return hist_value(b);
+        }
+    }
+    return 0;
+}
+
+/* xorshift64*, one state per thread */
+static uint64_t next_random(uint64_t *state)
+{
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+static void zipf_init(void)
+{
+    int n = opt.max_index + 1;
+    double sum = 0;
+
+    zipf_cdf = malloc(n * sizeof(double));
+    if (!zipf_cdf) {
+        perror("malloc");
+        exit(1);
+    }
+    for (int i = 0; i < n; ++i) {
+        sum += 1.0 / pow(i + 1, opt.zipf_s);
+        zipf_cdf[i] = sum;
+    }
+    for (int i = 0; i < n; ++i) {
+        zipf_cdf[i] /= sum;
+    }
+}
+
+/* small indices are the hot ones: rank r asks for F(r) */
+static int next_index(uint64_t *rng)
+{
+    if (opt.dist == DIST_FIXED) {
+        return opt.fixed_index;
+    }
+    if (opt.dist == DIST_UNIFORM) {
+        return next_random(rng) % (opt.max_index + 1);
+    }
+
+    double u = (next_random(rng) >> 11) * (1.0 / 9007199254740992.0);
+    int lo = 0, hi = opt.max_index;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (zipf_cdf[mid] < u) {
+            lo = mid + 1;
+        }
+        else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void *run_thread(void *arg)
+{
+    bench_thread *td = arg;
+    int top = opt.dist == DIST_FIXED ? opt.fixed_index : opt.max_index;
+    /* room for F(top) in any format: decimal needs ~0.21 bytes per index */
+    size_t buf_size = top / 4 + 64;
+    char *buf = malloc(buf_size);
+    int fd = shared_fd;
+
+    if (opt.nr_cpus) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(opt.cpus[td->thread_id % opt.nr_cpus], &set);
+        errno = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (errno) {
+            perror("pthread_setaffinity_np");
+        }
+    }
+    if (opt.private_fd) {
+        fd = open(FIB_DEV, O_RDWR);
+        if (fd < 0) {
+            fprintf(stderr, "Thread %d: Failed to open character device\n", td->thread_id);
+        }
+    }
+
+    pthread_barrier_wait(&barrier);
+
+    while (!stop && fd >= 0 && buf) {
+        int k = next_index(&td->rng);
+
+        uint64_t start = now_ns();
+        ssize_t sz = pread(fd, buf, opt.mode, k);
+        uint64_t elapsed = now_ns() - start;
+
+        if (sz < 0) {
+            td->errors++;
+        }
+        td->requests++;
+        td->hist[hist_bucket(elapsed)]++;
+        if (elapsed > td->max_ns) {
+            td->max_ns = elapsed;
+        }
+    }
+
+    if (opt.private_fd && fd >= 0) {
+        close(fd);
+    }
+    free(buf);
+    return NULL;
+}
+
+static void run(int nr_threads)
+{
+    static uint64_t hist[HIST_BUCKETS];
+    long long requests = 0, errors = 0;
+    uint64_t max_ns = 0;
+
+    stop = 0;
+    pthread_barrier_init(&barrier, NULL, nr_threads + 1);
+    for (int i = 0; i < nr_threads; ++i) {
+        memset(&threads[i], 0, sizeof(threads[i]));
+        threads[i].thread_id = i;
+        threads[i].rng = 0x9E3779B97F4A7C15ULL * (i + 1);
+        pthread_create(&threads[i].thread, NULL, run_thread, &threads[i]);
+    }
+
+    pthread_barrier_wait(&barrier);
+    uint64_t start = now_ns();
+    sleep(opt.seconds);
+    stop = 1;
+    for (int i = 0; i < nr_threads; ++i) {
+        pthread_join(threads[i].thread, NULL);
+    }
+    double seconds = (now_ns() - start) / 1e9;
+    pthread_barrier_destroy(&barrier);
+
+    memset(hist, 0, sizeof(hist));
+    for (int i = 0; i < nr_threads; ++i) {
+        requests += threads[i].requests;
+        errors += threads[i].errors;
+        if (threads[i].max_ns > max_ns) {
+            max_ns = threads[i].max_ns;
+        }
+        for (int b = 0; b < HIST_BUCKETS; ++b) {
+            hist[b] += threads[i].hist[b];
+        }
+    }
+
+    printf("%d,%d,%s,%lld,%lld,%.3f,%.0f,%llu,%llu,%llu,%llu,%llu\n", nr_threads, opt.mode,
+           dist_name[opt.dist], requests, errors, seconds, requests / seconds,
+           (unsigned long long) hist_percentile(hist, requests, 0.50),
+           (unsigned long long) hist_percentile(hist, requests, 0.90),
+           (unsigned long long) hist_percentile(hist, requests, 0.99),
+           (unsigned long long) hist_percentile(hist, requests, 0.999),
+           (unsigned long long) max_ns);
+    fflush(stdout);
+}
+
+/* parse "1,2,4" into @list, return the number of entries */
+static int parse_list(char *arg, int *list, int max)
+{
+    int n = 0;
+    for (char *tok = strtok(arg, ","); tok && n < max; tok = strtok(NULL, ",")) {
+        list[n++] = atoi(tok);
+    }
+    return n;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [-t 1,2,4,8] [-c cpu,cpu,...] [-m mode] [-d uniform|zipf|fixed]\n"
+            "       [-n max index] [-k fixed index] [-s zipf exponent] [-T seconds] [-p]\n",
+            prog);
+    exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+    int counts[MAX_THREADS] = {1, 2, 4, 8};
+    int nr_counts = 4;
+    int c;
+
+    while ((c = getopt(argc, argv, "t:c:m:d:n:k:s:T:p")) != -1) {
+        switch (c) {
+        case 't':
+            nr_counts = parse_list(optarg, counts, MAX_THREADS);
+            break;
+        case 'c':
+            opt.nr_cpus = parse_list(optarg, opt.cpus, MAX_CPUS);
+            break;
+        case 'm':
+            opt.mode = atoi(optarg);
+            break;
+        case 'd':
+            if (strcmp(optarg, "uniform") == 0) {
+                opt.dist = DIST_UNIFORM;
+            }
+            else if (strcmp(optarg, "zipf") == 0) {
+                opt.dist = DIST_ZIPF;
+            }
+            else if (strcmp(optarg, "fixed") == 0) {
+                opt.dist = DIST_FIXED;
+            }
+            else {
+                usage(argv[0]);
+            }
+            break;
+        case 'n':
+            opt.max_index = atoi(optarg);
+            break;
+        case 'k':
+            opt.fixed_index = atoi(optarg);
+            break;
+        case 's':
+            opt.zipf_s = atof(optarg);
+            break;
+        case 'T':
+            opt.seconds = atoi(optarg);
+            break;
+        case 'p':
+            opt.private_fd = 1;
+            break;
+        default:
+            usage(argv[0]);
+        }
+    }
+
+    for (int i = 0; i < nr_counts; ++i) {
+        if (counts[i] < 1 || counts[i] > MAX_THREADS) {
+            fprintf(stderr, "thread count must be 1 ~ %d\n", MAX_THREADS);
+            exit(1);
+        }
+    }
+    if (opt.max_index < 0 || opt.fixed_index < 0 || opt.seconds < 1) {
+        usage(argv[0]);
+    }
+
+    if (opt.dist == DIST_ZIPF) {
+        zipf_init();
+    }
+
+    if (!opt.private_fd) {
+        shared_fd = open(FIB_DEV, O_RDWR);
+        if (shared_fd < 0) {
+            perror("Failed to open character device");
+            exit(1);
+        }
+    }
+
+    printf("threads,mode,dist,requests,errors,seconds,qps,p50_ns,p90_ns,p99_ns,p999_ns,max_ns\n");
+    for (int i = 0; i < nr_counts; ++i) {
+        run(counts[i]);
+    }
+
+    if (shared_fd >= 0) {
+        close(shared_fd);
+    }
+    free(zipf_cdf);
+
+    return 0;
+}
@@ -0,0 +1,437 @@
+/* fib_check.c */
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "fibdrv.h"
+
+/*
+ * Differential test of every mode of the driver.
+ *
+ * For every index of the set (0 ~ 300, 2^j - 1 ~ 2^j + 1, and random ones up
+ * to the largest index) F(k) is read in decimal through every mode and
+ * checked against the others and against bc(1). The compute time of each
+ * mode (the best of a few write() runs per index) is summed up, and the
+ * totals may be compared with a baseline saved by an earlier run.
+ *
+ * usage: fib_check [-n largest index] [-r random indices] [-x repeats]
+ *                  [-b baseline] [-w] [-t tolerance %] [-B]
+ *
+ *   -b  compare with this baseline file, or write it with -w
+ *   -B  skip the bc reference and only cross-check the modes
+ *
+ * The exit status is 1 on a wrong result, 2 on a timing regression.
+ * The module has to allow the largest index (max_index).
+ *
+ * Every timed write() follows a read of the same F(k), which mode 8 would
+ * answer from its memo, so the memo parameter is off for the run and put
+ * back at exit. That needs root; without it mode 8 is left out of the
+ * baseline. "make check" builds and runs it.
+ *
+ * A module loaded with store= answers the stored indices from the file in
+ * every mode, which neither checks nor times the modes, so fib_check refuses
+ * to run until the module is reloaded without it.
+ */
+
+#define FIB_DEV "/dev/fibonacci"
+#define MEMO_PARAM "/sys/module/fibdrv/parameters/memo"
+#define STORE_PARAM "/sys/module/fibdrv/parameters/store"
+#define MAX_INDICES 4096
+/* the native modes are right up to F(93), the largest fibonacci in 64 bits */
+#define NATIVE_MAX 93
+#define SEED 2024
+
+static struct {
+    long long max_index;
+    int random;
+    int repeat;
+    const char *baseline;
+    int write_baseline;
+    double tolerance;
+    int use_bc;
+} opt = {
+    .max_index = 500,
+    .random = 200,
+    .repeat = 3,
+    .tolerance = 10,
+    .use_bc = 1,
+};
+
+static const char *mode_name[FIB_MODE_NR] = {
+    "fib_sequence",
+    "fast_doubling",
+    "fast_doubling_clz",
+    "bignum_decimal",
+    "bignum_bin",
+    "bignum_bin_fast_doubling",
+    "bignum_bin_fast_doubling_clz",
+    "bignum_fast_doubling_clz",
+    "bignum_limb",
+    "bignum_limb_matrix",
+    "bignum_limb_lucas",
+};
+
+/* bc with a fast doubling F(n), fed through a pipe and read back line by line */
+static const char bc_program[] =
+    "define g(n) {\n"
+    "  auto a, b, c, d\n"
+    "  if (n == 0) { q = 1; return (0); }\n"
+    "  a = g(n / 2); b = q\n"
+    "  c = a * (2 * b - a); d = a * a + b * b\n"
+    "  if (n % 2) { q = c + d; return (d); }\n"
+    "  q = d; return (c)\n"
+    "}\n";
+
+static FILE *bc_in, *bc_out;
+
+static void bc_start(void)
+{
+    int to_bc[2], from_bc[2];
+
+    if (pipe(to_bc) < 0 || pipe(from_bc) < 0) {
+        perror("pipe");
+        exit(1);
+    }
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        exit(1);
+    }
+    if (pid == 0) {
+        dup2(to_bc[0], STDIN_FILENO);
+        dup2(from_bc[1], STDOUT_FILENO);
+        close(to_bc[1]);
+        close(from_bc[0]);
+        /* no line splitting of long numbers */
+        setenv("BC_LINE_LENGTH", "0", 1);
+        execlp("bc", "bc", "-q", (char *) NULL);
+        perror("bc");
+        _exit(127);
+    }
+    close(to_bc[0]);
+    close(from_bc[1]);
+    bc_in = fdopen(to_bc[1], "w");
+    bc_out = fdopen(from_bc[0], "r");
+    fputs(bc_program, bc_in);
+}
+
+/* F(@k) in decimal from bc into @buf */
+static int bc_fib(long long k, char *buf, size_t size)
+{
+    fprintf(bc_in, "g(%lld)\n", k);
+    fflush(bc_in);
+    if (!fgets(buf, size, bc_out)) {
+        return -1;
+    }
+    buf[strcspn(buf, "\n")] = '\0';
+    return 0;
+}
+
+static int cmp_index(const void *a, const void *b)
+{
+    long long x = *(const long long *) a, y = *(const long long *) b;
+    return x < y ? -1 : x > y;
+}
+
+/* the index set, sorted and without duplicates */
+static int build_indices(long long *list)
+{
+    int n = 0;
+
+    for (long long k = 0; k <= 300 && k <= opt.max_index; ++k) {
+        list[n++] = k;
+    }
+    for (long long p = 2; p - 1 <= opt.max_index && n + 3 < MAX_INDICES; p <<= 1) {
+        for (long long k = p - 1; k <= p + 1 && k <= opt.max_index; ++k) {
+            list[n++] = k;
+        }
+    }
+    srand(SEED);
+    for (int i = 0; i < opt.random && n + 1 < MAX_INDICES; ++i) {
+        list[n++] = ((long long) rand() * RAND_MAX + rand()) % (opt.max_index + 1);
+    }
+    list[n++] = opt.max_index;
+
+    qsort(list, n, sizeof(long long), cmp_index);
+    int m = 0;
+    for (int i = 0; i < n; ++i) {
+        if (m == 0 || list[i] != list[m - 1]) {
+            list[m++] = list[i];
+        }
+    }
+    return m;
+}
+
+/* F(@k) through @mode in decimal, read_iter renders the native modes too */
+static ssize_t read_mode(int fd, int mode, long long k, char *buf, size_t size)
+{
+    struct iovec iov = {.iov_base = buf, .iov_len = size};
+
+    if (ioctl(fd, FIB_IOC_SET_MODE, &mode) < 0) {
+        return -1;
+    }
+    return preadv(fd, &iov, 1, k);
+}
+
+/* the best kernel time of @mode at @k over the repeats, in ns */
+static long long time_mode(int fd, int mode, long long k)
+{
+    char dummy[FIB_MODE_NR + 1];
+    long long best = -1;
+
+    for (int i = 0; i < opt.repeat; ++i) {
+        lseek(fd, k, SEEK_SET);
+        long long ns = write(fd, dummy, mode);
+        if (ns >= 0 && (best < 0 || ns < best)) {
+            best = ns;
+        }
+    }
+    return best;
+}
+
+/* the memo setting to put back, 0 while untouched */
+static char saved_memo;
+
+static int memo_set(char c)
+{
+    int fd = open(MEMO_PARAM, O_WRONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    int ok = write(fd, &c, 1) == 1;
+    close(fd);
+    return ok ? 0 : -1;
+}
+
+static void memo_restore(void)
+{
+    if (saved_memo) {
+        memo_set(saved_memo);
+    }
+}
+
+static void memo_restore_signal(int sig)
+{
+    memo_restore();
+    _exit(128 + sig);
+}
+
+/* turn the memo of mode 8 off until exit, return 0 or -1 if not allowed */
+static int memo_off(void)
+{
+    char c;
+    int fd = open(MEMO_PARAM, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    int ok = read(fd, &c, 1) == 1;
+    close(fd);
+    if (!ok || memo_set('N') < 0) {
+        return -1;
+    }
+
+    saved_memo = c;
+    atexit(memo_restore);
+    signal(SIGINT, memo_restore_signal);
+    signal(SIGTERM, memo_restore_signal);
+    return 0;
+}
+
+/* whether the module was loaded with a precomputed store */
+static int store_loaded(void)
+{
+    char name[256];
+    FILE *fp = fopen(STORE_PARAM, "r");
+    if (!fp) {
+        return 0;
+    }
+    int set = fgets(name, sizeof(name), fp) && name[0] != '\n' &&
+              strncmp(name, "(null)", 6) != 0;
+    fclose(fp);
+    return set;
+}
+
+static int load_baseline(long long *total)
+{
+    FILE *fp = fopen(opt.baseline, "r");
+    char name[64];
+    int mode;
+    long long ns;
+
+    if (!fp) {
+        perror(opt.baseline);
+        return -1;
+    }
+    for (int i = 0; i < FIB_MODE_NR; ++i) {
+        total[i] = -1;
+    }
+    while (fscanf(fp, "%d %63s %lld", &mode, name, &ns) == 3) {
+        if (mode >= 0 && mode < FIB_MODE_NR) {
+            total[mode] = ns;
+        }
+    }
+    fclose(fp);
+    return 0;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [-n largest index] [-r random indices] [-x repeats]\n"
+            "       [-b baseline] [-w] [-t tolerance %%] [-B]\n",
+            prog);
+    exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+    static long long index[MAX_INDICES];
+    long long total[FIB_MODE_NR] = {0};
+    int c, wrong = 0;
+
+    while ((c = getopt(argc, argv, "n:r:x:b:wt:B")) != -1) {
+        switch (c) {
+        case 'n':
+            opt.max_index = atoll(optarg);
+            break;
+        case 'r':
+            opt.random = atoi(optarg);
+            break;
+        case 'x':
+            opt.repeat = atoi(optarg);
+            break;
+        case 'b':
+            opt.baseline = optarg;
+            break;
+        case 'w':
+            opt.write_baseline = 1;
+            break;
+        case 't':
+            opt.tolerance = atof(optarg);
+            break;
+        case 'B':
+            opt.use_bc = 0;
+            break;
+        default:
+            usage(argv[0]);
+        }
+    }
+    if (opt.max_index < 0 || opt.repeat < 1 || (opt.write_baseline && !opt.baseline)) {
+        usage(argv[0]);
+    }
+
+    int fd = open(FIB_DEV, O_RDWR);
+    if (fd < 0) {
+        perror("Failed to open character device");
+        exit(1);
+    }
+    if (store_loaded()) {
+        fprintf(stderr, "%s is set, reload the module without it to check the modes\n",
+                STORE_PARAM);
+        exit(1);
+    }
+    int fmt = FIB_FMT_DEC;
+    if (ioctl(fd, FIB_IOC_SET_FORMAT, &fmt) < 0) {
+        perror("FIB_IOC_SET_FORMAT");
+        exit(1);
+    }
+    int memo_timed = memo_off() < 0;
+    if (memo_timed) {
+        fprintf(stderr, "%s: %s, mode 8 times its memo and stays out of the baseline\n",
+                MEMO_PARAM, strerror(errno));
+    }
+    if (opt.use_bc) {
+        signal(SIGPIPE, SIG_IGN);
+        bc_start();
+    }
+
+    int n = build_indices(index);
+    /* F(k) has about 0.209 k decimal digits */
+    size_t size = opt.max_index / 4 + 64;
+    char *expect = malloc(size), *got = malloc(size);
+    if (!expect || !got) {
+        perror("malloc");
+        exit(1);
+    }
+
+    for (int i = 0; i < n; ++i) {
+        long long k = index[i];
+
+        /* the reference is bc, or the first bignum mode without it */
+        if (opt.use_bc ? bc_fib(k, expect, size) < 0
+                       : read_mode(fd, FIB_MODE_DECIMAL, k, expect, size) < 0) {
+            fprintf(stderr, "F(%lld): no reference\n", k);
+            exit(1);
+        }
+
+        for (int mode = 0; mode < FIB_MODE_NR; ++mode) {
+            if (mode <= FIB_MODE_FAST_DOUBLING_CLZ && k > NATIVE_MAX) {
+                continue;
+            }
+            ssize_t len = read_mode(fd, mode, k, got, size);
+            if (len < 0) {
+                printf("FAIL %s F(%lld): %s\n", mode_name[mode], k, strerror(errno));
+                wrong++;
+            }
+            else if (strcmp(got, expect) != 0) {
+                printf("FAIL %s F(%lld): got %.40s, expected %.40s\n", mode_name[mode], k,
+                       got, expect);
+                wrong++;
+            }
+            total[mode] += time_mode(fd, mode, k);
+        }
+    }
+    printf("%d indices up to %lld, %d wrong results\n", n, opt.max_index, wrong);
+
+    int regressed = 0;
+    long long base[FIB_MODE_NR];
+    int compare = opt.baseline && !opt.write_baseline && load_baseline(base) == 0;
+
+    printf("%-4s %-30s %14s %14s %8s\n", "mode", "name", "total(ns)", "baseline(ns)", "change");
+    for (int mode = 0; mode < FIB_MODE_NR; ++mode) {
+        if (memo_timed && mode == FIB_MODE_LIMB) {
+            total[mode] = -1;
+        }
+        if (!compare || base[mode] <= 0 || total[mode] < 0) {
+            printf("%-4d %-30s %14lld\n", mode, mode_name[mode], total[mode]);
+            continue;
+        }
+        double change = (total[mode] - base[mode]) * 100.0 / base[mode];
+        int slow = change > opt.tolerance;
+        printf("%-4d %-30s %14lld %14lld %+7.1f%%%s\n", mode, mode_name[mode], total[mode],
+               base[mode], change, slow ? " REGRESSION" : "");
+        regressed += slow;
+    }
+
+    if (opt.write_baseline) {
+        FILE *fp = fopen(opt.baseline, "w");
+        if (!fp) {
+            perror(opt.baseline);
+            exit(1);
+        }
+        for (int mode = 0; mode < FIB_MODE_NR; ++mode) {
+            fprintf(fp, "%d %s %lld\n", mode, mode_name[mode], total[mode]);
+        }
+        fclose(fp);
+    }
+
+    close(fd);
+    if (bc_in) {
+        fclose(bc_in);
+        fclose(bc_out);
+        wait(NULL);
+    }
+    free(expect);
+    free(got);
+
+    return wrong ? 1 : regressed ? 2 : 0;
+}
@@ -0,0 +1,143 @@
+/* fib_store.c */
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "fibdrv.h"
+
+/*
+ * Builds the precomputed store of the module (struct fib_store_hdr).
+ * The values come from the driver itself in raw format, so the module has
+ * to be loaded with max_index (and the memory limits) covering the indices.
+ *
+ * usage: fib_store [-m mode] output index|first-last[:step] ...
+ *
+ * Install the output under /lib/firmware and load the module with
+ * store=<name>, e.g.
+ *   ./fib_store fibdrv.store 100000 500000-1000000:100000
+ *   cp fibdrv.store /lib/firmware/ && insmod fibdrv.ko store=fibdrv.store
+ *
+ * The file is written little-endian, so build it on a little-endian host.
+ */
+
+#define FIB_DEV "/dev/fibonacci"
+#define MODE FIB_MODE_LIMB_LUCAS
+#define MAX_INDICES 65536
+
+/* CRC-32 as in zlib, what the kernel gets from crc32_le(~0, ...) ^ ~0 */
+static uint32_t crc32(const void *data, size_t len)
+{
+    const unsigned char *p = data;
+    uint32_t crc = ~0U;
+
+    while (len--) {
+        crc ^= *p++;
+        for (int i = 0; i < 8; ++i) {
+            crc = (crc >> 1) ^ (0xEDB88320U & -(crc & 1));
+        }
+    }
+    return ~crc;
+}
+
+/* parse "k" or "first-last[:step]" into @list, return the number of entries */
+static int parse_range(const char *arg, long long *list, int n)
+{
+    long long first, last = -1, step = 1;
+
+    if (sscanf(arg, "%lld-%lld:%lld", &first, &last, &step) < 2) {
+        last = first;
+    }
+    if (first < 0 || last < first || step < 1) {
+        fprintf(stderr, "bad index range %s\n", arg);
+        exit(1);
+    }
+    for (long long k = first; k <= last && n < MAX_INDICES; k += step) {
+        list[n++] = k;
+    }
+    return n;
+}
+
+int main(int argc, char *argv[])
+{
+    static long long index[MAX_INDICES];
+    int mode = MODE;
+    int fmt = FIB_FMT_RAW;
+    int c, n = 0;
+
+    while ((c = getopt(argc, argv, "m:")) != -1) {
+        if (c == 'm') {
+            mode = atoi(optarg);
+        }
+        else {
+            exit(1);
+        }
+    }
+    if (argc - optind < 2) {
+        fprintf(stderr, "usage: %s [-m mode] output index|first-last[:step] ...\n", argv[0]);
+        exit(1);
+    }
+    for (int i = optind + 1; i < argc; ++i) {
+        n = parse_range(argv[i], index, n);
+    }
+
+    int fd = open(FIB_DEV, O_RDWR);
+    if (fd < 0) {
+        perror("Failed to open character device");
+        exit(1);
+    }
+    if (ioctl(fd, FIB_IOC_SET_MODE, &mode) < 0 || ioctl(fd, FIB_IOC_SET_FORMAT, &fmt) < 0) {
+        perror("ioctl");
+        exit(1);
+    }
+
+    FILE *out = fopen(argv[optind], "wb");
+    if (!out) {
+        perror("fopen");
+        exit(1);
+    }
+
+    struct fib_store_hdr hdr = {
+        .magic = FIB_STORE_MAGIC,
+        .version = FIB_STORE_VERSION,
+        .count = n,
+    };
+    fwrite(&hdr, sizeof(hdr), 1, out);
+
+    for (int i = 0; i < n; ++i) {
+        /* F(k) has about 0.695 k bits */
+        size_t room = index[i] / 11 + 64;
+        char *buf = malloc(room);
+        struct iovec iov = {.iov_base = buf, .iov_len = room};
+
+        ssize_t len = buf ? preadv(fd, &iov, 1, index[i]) : -1;
+        if (len <= 0 || len % 8) {
+            fprintf(stderr, "F(%lld): %s\n", index[i], len < 0 ? strerror(errno) : "bad length");
+            exit(1);
+        }
+
+        struct fib_store_rec rec = {
+            .k = index[i],
+            .limbs = len / 8,
+            .crc = crc32(buf, len),
+        };
+        fwrite(&rec, sizeof(rec), 1, out);
+        fwrite(buf, len, 1, out);
+        free(buf);
+    }
+
+    if (fclose(out) != 0) {
+        perror("fclose");
+        exit(1);
+    }
+    close(fd);
+    fprintf(stderr, "%d results written to %s\n", n, argv[optind]);
+
+    return 0;
+}
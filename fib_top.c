@@ -0,0 +1,134 @@
+/* fib_top.c */
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * top for the requests the driver is working on.
+ *
+ * Polls <debugfs>/fibonacci/requests and shows, longest running first, who
+ * asked for what and how far the engine got: steps are doubling steps (bits
+ * of the index) for the doubling, matrix and Lucas modes and additions for
+ * the iterative ones. A doubling step costs about four times the one before
+ * it, so most of the time goes to the last few.
+ *
+ * usage: fib_top [-d delay ms] [-n iterations] [-K ms]
+ *
+ *   -K  SIGKILL the requests that have been running for longer than ms;
+ *       the engines notice it at their next step and return EINTR
+ *
+ * Needs root for debugfs (and for -K on other users' processes).
+ */
+
+#define FIB_REQUESTS "/sys/kernel/debug/fibonacci/requests"
+#define MAX_REQUESTS 256
+
+struct request {
+    int pid;
+    char comm[32];
+    long long index;
+    int mode;
+    long long step;
+    long long steps;
+    unsigned long bytes;
+    long long elapsed_us;
+};
+
+static int cmp_elapsed(const void *a, const void *b)
+{
+    const struct request *x = a, *y = b;
+    return x->elapsed_us < y->elapsed_us ? 1 : x->elapsed_us > y->elapsed_us ? -1 : 0;
+}
+
+/* return: the number of requests read, or -1 if the file is missing */
+static int read_requests(struct request *req)
+{
+    char line[256];
+    int n = 0;
+
+    FILE *fp = fopen(FIB_REQUESTS, "r");
+    if (!fp) {
+        return -1;
+    }
+    /* skip the header */
+    if (!fgets(line, sizeof(line), fp)) {
+        fclose(fp);
+        return 0;
+    }
+    while (n < MAX_REQUESTS && fgets(line, sizeof(line), fp)) {
+        struct request *r = &req[n];
+        if (sscanf(line, "%d %lld %d %lld %lld %lu %lld %31[^\n]", &r->pid, &r->index,
+                   &r->mode, &r->step, &r->steps, &r->bytes, &r->elapsed_us, r->comm) == 8) {
+            n++;
+        }
+    }
+    fclose(fp);
+
+    return n;
+}
+
+static void show(struct request *req, int n, long long kill_us)
+{
+    time_t now = time(NULL);
+
+    /* clear the screen and go home */
+    printf("\033[H\033[J");
+    printf("fibdrv requests: %d in flight, %s", n, ctime(&now));
+    printf("%7s %-16s %12s %4s %19s %12s %12s\n", "PID", "COMM", "INDEX", "MODE", "STEP",
+           "MEM(KiB)", "ELAPSED(ms)");
+
+    for (int i = 0; i < n; ++i) {
+        struct request *r = &req[i];
+        char step[32];
+        snprintf(step, sizeof(step), "%lld/%lld %3.0f%%", r->step, r->steps,
+                 r->steps ? 100.0 * r->step / r->steps : 100.0);
+
+        int killed = kill_us > 0 && r->elapsed_us > kill_us && kill(r->pid, SIGKILL) == 0;
+        printf("%7d %-16s %12lld %4d %19s %12lu %12.1f%s\n", r->pid, r->comm, r->index,
+               r->mode, step, r->bytes >> 10, r->elapsed_us / 1000.0,
+               killed ? "  killed" : "");
+    }
+    fflush(stdout);
+}
+
+int main(int argc, char *argv[])
+{
+    static struct request req[MAX_REQUESTS];
+    int delay_ms = 1000, iterations = 0;
+    long long kill_us = 0;
+    int c;
+
+    while ((c = getopt(argc, argv, "d:n:K:")) != -1) {
+        switch (c) {
+        case 'd':
+            delay_ms = atoi(optarg);
+            break;
+        case 'n':
+            iterations = atoi(optarg);
+            break;
+        case 'K':
+            kill_us = atoll(optarg) * 1000;
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-d delay ms] [-n iterations] [-K ms]\n", argv[0]);
+            exit(1);
+        }
+    }
+
+    for (int i = 0; iterations == 0 || i < iterations; ++i) {
+        int n = read_requests(req);
+        if (n < 0) {
+            perror(FIB_REQUESTS);
+            exit(1);
+        }
+        qsort(req, n, sizeof(struct request), cmp_elapsed);
+        show(req, n, kill_us);
+        usleep(delay_ms * 1000);
+    }
+
+    return 0;
+}
@@ -9,9 +9,32 @@
 #include <linux/version.h>
 #include <linux/mm.h>
 #include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/nodemask.h>
+#include <linux/topology.h>
+#include <linux/firmware.h>
+#include <linux/crc32.h>
+#include <linux/sort.h>
+#include <linux/bsearch.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/list.h>
+#include <linux/hashtable.h>
+#include <linux/completion.h>
+#include <linux/workqueue.h>
+#include <linux/refcount.h>
+#include <linux/spinlock.h>
 #include <linux/ktime.h>
 #include <linux/uaccess.h>
 #include <linux/string.h>
+#include <linux/uio.h>
+#include <linux/sched.h>
+#include <linux/sched/signal.h>
+#include <linux/sched/mm.h>
+#include <linux/memcontrol.h>
+
+#include "bn_kernels.h"
+#include "fibdrv.h"
 
 MODULE_LICENSE("Dual MIT/GPL");
 MODULE_AUTHOR("National Cheng Kung University, Taiwan");
@@ -27,6 +50,520 @@ static struct class *fib_class;
 static DEFINE_MUTEX(fib_mutex);
 static int major = 0, minor = 0;
 
+/* the largest index lseek accepts, raise it with care */
+static long long max_index = MAX_LENGTH;
+module_param(max_index, llong, 0644);
+MODULE_PARM_DESC(max_index, "largest fibonacci index a client may ask for");
+
+/* memory budgets of the bignum modes in bytes, 0 means unlimited */
+static unsigned long request_mem_limit = 64UL << 20;
+module_param(request_mem_limit, ulong, 0644);
+MODULE_PARM_DESC(request_mem_limit, "estimated peak memory one request may use");
+
+static unsigned long global_mem_limit = 256UL << 20;
+module_param(global_mem_limit, ulong, 0644);
+MODULE_PARM_DESC(global_mem_limit, "estimated peak memory all requests together may use");
+
+/*
+ * bignum buffer allocator
+ *
+ * Every buffer of the bignum routines comes from here instead of plain
+ * kmalloc. Requests are rounded up to a power-of-two size class, each class
+ * backed by its own kmem_cache, and freed buffers are parked on a small
+ * per-CPU freelist so the steady stream of same-sized temporaries in the
+ * fibonacci loops rarely reaches the slab allocator at all.
+ * Requests larger than the biggest class go to fib_alloc_large() directly.
+ * All of it is charged to the memory cgroup of the calling process.
+ */
+#define FIB_ALLOC_MIN_SHIFT 5   /* 32 bytes */
+#define FIB_ALLOC_MAX_SHIFT 16  /* 64 KiB */
+#define FIB_ALLOC_CLASSES (FIB_ALLOC_MAX_SHIFT - FIB_ALLOC_MIN_SHIFT + 1)
+#define FIB_ALLOC_LARGE FIB_ALLOC_CLASSES
+#define FIB_PCP_DEPTH 16
+
+/* header in front of every buffer, keeps the payload 16 bytes aligned */
+struct fib_alloc_hdr {
+    size_t size;    /* the size requested by the caller */
+    int cls;        /* size class, or FIB_ALLOC_LARGE */
+} __aligned(16);
+
+/* per-CPU freelists, one stack of cached buffers per size class */
+struct fib_pcp {
+    int count[FIB_ALLOC_CLASSES];
+    void *obj[FIB_ALLOC_CLASSES][FIB_PCP_DEPTH];
+};
+
+static struct kmem_cache *fib_cache[FIB_ALLOC_CLASSES];
+static char fib_cache_name[FIB_ALLOC_CLASSES][24];
+static struct fib_pcp __percpu *fib_pcp;
+
+static struct {
+    atomic64_t allocs;
+    atomic64_t frees;
+    atomic64_t bytes_in_use;
+    atomic64_t bytes_peak;
+} fib_alloc_stat;
+
+/*
+ * placement of the buffers beyond the largest class, see fib_alloc_large()
+ *
+ * Near F(10^8) the operands are tens of MB and the multiply walks them over
+ * and over, so 4 KiB mappings cost a dTLB miss every 512 limbs and a buffer
+ * on the far node pays the remote latency on every one of them.
+ */
+enum fib_large_policy {
+    FIB_LARGE_DEFAULT = 0,      /* kvmalloc, wherever the task policy says */
+    FIB_LARGE_LOCAL = 1,        /* the NUMA node of the calling CPU */
+    FIB_LARGE_HUGE = 2,         /* local, mapped with huge pages when it spans one */
+    FIB_LARGE_INTERLEAVE = 3,   /* page by page over all online nodes */
+};
+
+static int large_alloc = FIB_LARGE_HUGE;
+module_param(large_alloc, int, 0644);
+MODULE_PARM_DESC(large_alloc,
+                 "placement of large bignum buffers: 0 default, 1 local node, "
+                 "2 huge pages, 3 interleaved");
+
+/* the number of bytes a buffer of class @cls occupies */
+static inline size_t fib_class_size(int cls)
+{
+    return (size_t) 1 << (cls + FIB_ALLOC_MIN_SHIFT);
+}
+
+/* the smallest class that holds @size bytes plus the header */
+static inline int fib_size_class(size_t size)
+{
+    size_t total = size + sizeof(struct fib_alloc_hdr);
+
+    if (total > fib_class_size(FIB_ALLOC_CLASSES - 1)) {
+        return FIB_ALLOC_LARGE;
+    }
+    if (total <= fib_class_size(0)) {
+        return 0;
+    }
+    return fls64(total - 1) - FIB_ALLOC_MIN_SHIFT;
+}
+
+static void fib_alloc_account(long bytes)
+{
+    s64 now = atomic64_add_return(bytes, &fib_alloc_stat.bytes_in_use);
+    s64 peak = atomic64_read(&fib_alloc_stat.bytes_peak);
+
+    while (now > peak) {
+        if (atomic64_try_cmpxchg(&fib_alloc_stat.bytes_peak, &peak, now)) {
+            break;
+        }
+    }
+}
+
+/*
+ * interleave @bytes over the online nodes one page at a time, for
+ * multiplies whose threads run on every node
+ * the pages go back with the mapping, vfree() drops them and the array
+ */
+static void *fib_vmap_interleave(size_t bytes, gfp_t gfp)
+{
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 10, 0)
+    unsigned int nr = DIV_ROUND_UP(bytes, PAGE_SIZE);
+    struct page **pages = kvmalloc_array(nr, sizeof(*pages), GFP_KERNEL);
+    int node = numa_node_id();
+    void *addr = NULL;
+    unsigned int i;
+
+    if (!pages) {
+        return NULL;
+    }
+
+    for (i = 0; i < nr; ++i) {
+        node = next_online_node(node);
+        if (node >= MAX_NUMNODES) {
+            node = first_online_node;
+        }
+        pages[i] = alloc_pages_node(node, gfp, 0);
+        if (!pages[i]) {
+            break;
+        }
+    }
+
+    if (i == nr) {
+        addr = vmap(pages, nr, VM_MAP | VM_MAP_PUT_PAGES, PAGE_KERNEL);
+        if (addr) {
+            return addr;
+        }
+    }
+
+    while (i > 0) {
+        __free_page(pages[--i]);
+    }
+    kvfree(pages);
+    return NULL;
+#else
+    return kvmalloc(bytes, gfp);
+#endif
+}
+
+/*
+ * function to allocate a buffer beyond the largest class, as large_alloc says
+ * every variant is released with kvfree()
+ */
+static void *fib_alloc_large(size_t bytes)
+{
+    gfp_t gfp = GFP_KERNEL_ACCOUNT;
+
+    switch (READ_ONCE(large_alloc)) {
+    case FIB_LARGE_LOCAL:
+        return kvmalloc_node(bytes, gfp, numa_node_id());
+    case FIB_LARGE_HUGE:
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 18, 0)
+        /* PMD mappings where the arch has them, local pages either way */
+        if (bytes >= PMD_SIZE) {
+            return vmalloc_huge(bytes, gfp);
+        }
+#endif
+        return kvmalloc_node(bytes, gfp, numa_node_id());
+    case FIB_LARGE_INTERLEAVE:
+        if (num_online_nodes() > 1) {
+            return fib_vmap_interleave(bytes, gfp);
+        }
+        return kvmalloc(bytes, gfp);
+    default:
+        return kvmalloc(bytes, gfp);
+    }
+}
+
+/*
+ * function to allocate a bignum buffer
+ * @size: the number of bytes needed
+ * return: the buffer, or NULL when out of memory
+ */
+static void *fib_alloc(size_t size)
+{
+    int cls = fib_size_class(size);
+    struct fib_alloc_hdr *hdr = NULL;
+    size_t bytes;
+
+    if (cls == FIB_ALLOC_LARGE) {
+        bytes = size + sizeof(struct fib_alloc_hdr);
+        hdr = fib_alloc_large(bytes);
+    }
+    else {
+        struct fib_pcp *pcp = get_cpu_ptr(fib_pcp);
+        if (pcp->count[cls] > 0) {
+            hdr = pcp->obj[cls][--pcp->count[cls]];
+        }
+        put_cpu_ptr(fib_pcp);
+
+        if (!hdr) {
+            hdr = kmem_cache_alloc(fib_cache[cls], GFP_KERNEL);
+        }
+        bytes = fib_class_size(cls);
+    }
+
+    if (!hdr) {
+        return NULL;
+    }
+
+    hdr->size = size;
+    hdr->cls = cls;
+    atomic64_inc(&fib_alloc_stat.allocs);
+    fib_alloc_account(bytes);
+
+    return hdr + 1;
+}
+
+static void fib_free(const void *ptr)
+{
+    if (!ptr) {
+        return;
+    }
+
+    struct fib_alloc_hdr *hdr = (struct fib_alloc_hdr *)ptr - 1;
+    int cls = hdr->cls;
+
+    atomic64_inc(&fib_alloc_stat.frees);
+
+    if (cls == FIB_ALLOC_LARGE) {
+        atomic64_sub(hdr->size + sizeof(struct fib_alloc_hdr), &fib_alloc_stat.bytes_in_use);
+        kvfree(hdr);
+        return;
+    }
+
+    atomic64_sub(fib_class_size(cls), &fib_alloc_stat.bytes_in_use);
+
+    struct fib_pcp *pcp = get_cpu_ptr(fib_pcp);
+    if (pcp->count[cls] < FIB_PCP_DEPTH) {
+        pcp->obj[cls][pcp->count[cls]++] = hdr;
+        hdr = NULL;
+    }
+    put_cpu_ptr(fib_pcp);
+
+    if (hdr) {
+        kmem_cache_free(fib_cache[cls], hdr);
+    }
+}
+
+/*
+ * function to resize a bignum buffer, the content is preserved
+ * the buffer is grown in place whenever its size class still has room
+ * return: the resized buffer, or NULL when out of memory (@ptr is untouched)
+ */
+static void *fib_realloc(void *ptr, size_t size)
+{
+    if (!ptr) {
+        return fib_alloc(size);
+    }
+
+    struct fib_alloc_hdr *hdr = (struct fib_alloc_hdr *)ptr - 1;
+    if (hdr->cls != FIB_ALLOC_LARGE && fib_size_class(size) <= hdr->cls) {
+        hdr->size = size;
+        return ptr;
+    }
+
+    void *res = fib_alloc(size);
+    if (!res) {
+        return NULL;
+    }
+    memcpy(res, ptr, min(size, hdr->size));
+    fib_free(ptr);
+
+    return res;
+}
+
+static int fib_alloc_init(void)
+{
+    fib_pcp = alloc_percpu(struct fib_pcp);
+    if (!fib_pcp) {
+        return -ENOMEM;
+    }
+
+    for (int i = 0; i < FIB_ALLOC_CLASSES; ++i) {
+        snprintf(fib_cache_name[i], sizeof(fib_cache_name[i]), "fib_bignum_%zu",
+                 fib_class_size(i));
+        fib_cache[i] = kmem_cache_create(fib_cache_name[i], fib_class_size(i),
+                                         16, SLAB_ACCOUNT, NULL);
+        if (!fib_cache[i]) {
+            while (--i >= 0) {
+                kmem_cache_destroy(fib_cache[i]);
+            }
+            free_percpu(fib_pcp);
+            return -ENOMEM;
+        }
+    }
+
+    return 0;
+}
+
+static void fib_alloc_exit(void)
+{
+    int cpu;
+
+    /* give the parked buffers back before the caches go away */
+    for_each_possible_cpu(cpu) {
+        struct fib_pcp *pcp = per_cpu_ptr(fib_pcp, cpu);
+        for (int i = 0; i < FIB_ALLOC_CLASSES; ++i) {
+            while (pcp->count[i] > 0) {
+                kmem_cache_free(fib_cache[i], pcp->obj[i][--pcp->count[i]]);
+            }
+        }
+    }
+    free_percpu(fib_pcp);
+
+    for (int i = 0; i < FIB_ALLOC_CLASSES; ++i) {
+        kmem_cache_destroy(fib_cache[i]);
+    }
+}
+
+/*
+ * per-request memory budget
+ *
+ * Before a bignum request starts, its peak memory is estimated from the index
+ * and reserved against global_mem_limit. A request whose estimate alone is
+ * above request_mem_limit is refused with -E2BIG, one that does not fit in
+ * what is left of the global budget is refused with -EAGAIN.
+ */
+static struct {
+    atomic64_t reserved;
+    atomic64_t reserved_peak;
+    atomic64_t rejected;
+} fib_mem_stat;
+
+/*
+ * function that estimates the peak memory of calculating F(k)
+ * F(k) has about k * log2(phi) ~= 0.694 * k binary digits, and every
+ * representation here spends a byte per digit. The factors cover the
+ * operands and temporaries alive at once, rounded up to their size class.
+ */
+static unsigned long fib_estimate_bytes(long long k, int mode, int fmt)
+{
+    unsigned long bits = mult_frac((unsigned long) k, 694242, 1000000) + 2;
+    unsigned long bytes;
+
+    if (mode == 3) {
+        /* two decimal numbers of ~0.3 digits per bit */
+        bytes = bits * 2;
+    }
+    else if (mode == 4) {
+        /* two binary numbers */
+        bytes = bits * 4;
+    }
+    else if (mode >= 8) {
+        /* limbs pack 8 bits a byte: the memo, five temporaries and a product */
+        bytes = bits * 2;
+    }
+    else {
+        /* a, b, t1, t2 and four temporaries of up to a full product */
+        bytes = bits * 16;
+    }
+
+    if (fmt == FIB_FMT_DEC) {
+        bytes += bits / 3 + 2;
+    }
+    else {
+        /* the limbs, plus the hex string */
+        bytes += bits / 8 + 8;
+        if (fmt == FIB_FMT_HEX) {
+            bytes += bits / 4 + 1;
+        }
+    }
+
+    return bytes;
+}
+
+/* reserve @bytes for a request, return 0 or the error to hand to the user */
+static int fib_mem_reserve(unsigned long bytes)
+{
+    unsigned long limit = READ_ONCE(request_mem_limit);
+    if (limit && bytes > limit) {
+        atomic64_inc(&fib_mem_stat.rejected);
+        return -E2BIG;
+    }
+
+    s64 now = atomic64_add_return(bytes, &fib_mem_stat.reserved);
+    limit = READ_ONCE(global_mem_limit);
+    if (limit && now > limit) {
+        atomic64_sub(bytes, &fib_mem_stat.reserved);
+        atomic64_inc(&fib_mem_stat.rejected);
+        return -EAGAIN;
+    }
+
+    s64 peak = atomic64_read(&fib_mem_stat.reserved_peak);
+    while (now > peak) {
+        if (atomic64_try_cmpxchg(&fib_mem_stat.reserved_peak, &peak, now)) {
+            break;
+        }
+    }
+
+    return 0;
+}
+
+static void fib_mem_release(unsigned long bytes)
+{
+    atomic64_sub(bytes, &fib_mem_stat.reserved);
+}
+
+/*
+ * function called by the long running loops at step boundaries
+ * it gives the CPU away if someone else needs it, and tells the caller to
+ * give up once the requesting process has been killed (e.g. by Ctrl-C)
+ * the caller then frees what it holds and returns NULL
+ */
+static bool fib_should_stop(void)
+{
+    cond_resched();
+    return fatal_signal_pending(current);
+}
+
+/*
+ * progress of the bignum requests in flight
+ *
+ * Every request links a record on its stack into fib_progress_list for as
+ * long as it runs, and hands it down to the engine, whose main loop reports
+ * through fib_progress() how many of its steps are done: doubling steps
+ * (one per bit of k) for the fast doubling, matrix and Lucas engines,
+ * additions for the iterative ones, which report every 1024th. Only the
+ * list itself is under fib_progress_lock, the step is a plain store read
+ * by debugfs. debugfs shows the list as fibonacci/requests, which
+ * fib_top.c polls; a runaway request is ended by killing its pid.
+ */
+struct fib_progress {
+    struct list_head node;
+    struct task_struct *task;
+    pid_t pid;
+    char comm[TASK_COMM_LEN];
+    long long k;
+    int mode;
+    unsigned long bytes;    /* the memory reserved for the request */
+    ktime_t start;
+    long long step;         /* steps done */
+    long long steps;        /* steps of the whole calculation */
+    const bool *cancel;     /* stops the engine once set, for work on behalf of another task */
+};
+
+static LIST_HEAD(fib_progress_list);
+static DEFINE_SPINLOCK(fib_progress_lock);
+
+/* the number of main loop steps mode @mode takes for F(@k) */
+static long long fib_progress_steps(long long k, int mode)
+{
+    if (mode == 3 || mode == 4) {
+        return k;
+    }
+    if (mode == 5) {
+        /* bignum_bin_fast_doubling walks all 32 bits */
+        return 32;
+    }
+    return fls64(k);
+}
+
+static void fib_progress_begin(struct fib_progress *p, long long k, int mode,
+                               unsigned long bytes)
+{
+    p->task = current;
+    p->pid = task_pid_nr(current);
+    get_task_comm(p->comm, current);
+    p->k = k;
+    p->mode = mode;
+    p->bytes = bytes;
+    p->start = ktime_get();
+    p->step = 0;
+    p->steps = fib_progress_steps(k, mode);
+    p->cancel = NULL;
+
+    spin_lock(&fib_progress_lock);
+    list_add_tail(&p->node, &fib_progress_list);
+    spin_unlock(&fib_progress_lock);
+}
+
+static void fib_progress_end(struct fib_progress *p)
+{
+    spin_lock(&fib_progress_lock);
+    list_del(&p->node);
+    spin_unlock(&fib_progress_lock);
+}
+
+/*
+ * function called by the main loop of an engine once per step
+ * records in @p, if any, that @done steps are over, then acts as
+ * fib_should_stop(), also stopping once the cancel flag of @p is set
+ */
+static bool fib_progress(struct fib_progress *p, long long done)
+{
+    if (p) {
+        WRITE_ONCE(p->step, done);
+        if (p->cancel && READ_ONCE(*p->cancel)) {
+            return true;
+        }
+    }
+
+    return fib_should_stop();
+}
+
+/* the error of a bignum routine that returned NULL */
+static int fib_abort_errno(void)
+{
+    return fatal_signal_pending(current) ? -EINTR : -ENOMEM;
+}
+
 #define BIGNUM char
 
 /* how much byte to store length of the char array */
@@ -37,14 +574,17 @@ static int major = 0, minor = 0;
 /* bn_ptr is a pointer to BIGNUM */
 #define GET_LEN(bn_ptr) *(int *)(bn_ptr)
 
-#define FREE_BIGNUM(bn_ptr) kfree(bn_ptr)
+#define FREE_BIGNUM(bn_ptr) fib_free(bn_ptr)
 /* bn_ptr is a pointer to BIGNUM */
 
 /* function to new a BIGNUM
 /* @len: contains null terminator */
 BIGNUM *bignum_new(int len)
 {
-    BIGNUM *res = (BIGNUM *)kmalloc(sizeof(BIGNUM) * (len + LEN_BYTE), GFP_KERNEL);
+    BIGNUM *res = (BIGNUM *)fib_alloc(sizeof(BIGNUM) * (len + LEN_BYTE));
+    if (!res) {
+        return NULL;
+    }
     *(unsigned int *)res = len;
 
     for (int i = LEN_BYTE; i < (len + LEN_BYTE); ++i) {
@@ -58,16 +598,16 @@ BIGNUM *bignum_new(int len)
 BIGNUM *bignum_add(BIGNUM *num1, BIGNUM *num2)
 {
     BIGNUM *res = bignum_new(GET_LEN(num2) + 1);
+    if (!res) {
+        return NULL;
+    }
 
     int idx = 0, carry = 0;
     while (idx <= (GET_LEN(num1)) - 2) {
         int sum = ((char)*(num1 + LEN_BYTE + idx) - '0') + ((char)*(num2 + LEN_BYTE + idx) - '0') + carry;
 
-        carry = 0;
-        if (sum >= 2) {
-            sum -= 2;
-            carry = 1;
-        }
+        carry = sum >> 1;
+        sum &= 1;
 
         *(res + LEN_BYTE + idx) = (char)(sum + '0');
         idx++;
@@ -76,11 +616,8 @@ BIGNUM *bignum_add(BIGNUM *num1, BIGNUM *num2)
     while (idx <= (GET_LEN(num2)) - 2) {
         int sum = (*(num2 + LEN_BYTE + idx) - '0') + carry;
 
-        carry = 0;
-        if (sum >= 2) {
-            sum -= 2;
-            carry = 1;
-        }
+        carry = sum >> 1;
+        sum &= 1;
 
         *(res + LEN_BYTE + idx) = (char)(sum + '0');
         idx++;
@@ -102,6 +639,11 @@ BIGNUM *bignum_fib(long long k)
 {
     BIGNUM *n1 = bignum_new(2);
     BIGNUM *n2 = bignum_new(2);
+    if (!n1 || !n2) {
+        FREE_BIGNUM(n1);
+        FREE_BIGNUM(n2);
+        return NULL;
+    }
     *(n2 + LEN_BYTE) = '1';
 
     BIGNUM *sum;
@@ -116,8 +658,12 @@ BIGNUM *bignum_fib(long long k)
     }
 
     for (int i = 2; i <= k; ++i) {
-        sum = bignum_add(n1, n2);
+        sum = fib_should_stop() ? NULL : bignum_add(n1, n2);
         FREE_BIGNUM(n1);
+        if (!sum) {
+            FREE_BIGNUM(n2);
+            return NULL;
+        }
         n1 = n2;
         n2 = sum;
     }
@@ -129,13 +675,20 @@ BIGNUM *bignum_fib(long long k)
 char *bignum_to_decimal(const BIGNUM *binary)
 {
     size_t len = GET_LEN(binary)/3 + 2;
-    char *decimal = (char *)kmalloc(sizeof(char) * len, GFP_KERNEL);
+    char *decimal = (char *)fib_alloc(sizeof(char) * len);
+    if (!decimal) {
+        return NULL;
+    }
 
     for (int i = 0; i < len; ++i) {
         *(decimal + i) = '0';
     }
 
     for (int i = GET_LEN(binary) - 2 + LEN_BYTE; i >= LEN_BYTE; --i) {
+        if ((i & 0x3ff) == 0 && fib_should_stop()) {
+            fib_free(decimal);
+            return NULL;
+        }
         int digit = *(binary + i) - '0';
 
         for (int j = 0; j < len; ++j) {
@@ -145,15 +698,15 @@ char *bignum_to_decimal(const BIGNUM *binary)
         }
     }
 
-    // 找到 \0 應該要放的位置
-    int idx = len - 1;
-    for (int i = len - 1; i >= 0; --i) {
+    // 找到 \0 應該要放的位置，全為 0 時留下一個 "0"
+    int idx = 1;
+    for (int i = len - 1; i > 1; --i) {
         if (decimal[i - 1] != '0') {
-            decimal[i] = '\0';
             idx = i;
             break;
         }
     }
+    decimal[idx] = '\0';
 
     // 把 string 反轉
     for (int i = 0; i < idx/2; ++i) {
@@ -168,9 +721,16 @@ char *bignum_to_decimal(const BIGNUM *binary)
 BIGNUM *bignum_mul(BIGNUM *n1, BIGNUM *n2)
 {
     BIGNUM *res = bignum_new(GET_LEN(n1) - 1 + GET_LEN(n2) - 1 + 1);
+    if (!res) {
+        return NULL;
+    }
     int n1_len = GET_LEN(n1), n2_len = GET_LEN(n2);
 
     for (int i = LEN_BYTE; i < n1_len - 1 + LEN_BYTE; ++i) {
+        if ((i & 0x3ff) == 0 && fib_should_stop()) {
+            FREE_BIGNUM(res);
+            return NULL;
+        }
         if (*(n1 + i) == '1') {
             int carry = 0;
             int digit = *(n1 + i) - '0';
@@ -179,11 +739,8 @@ BIGNUM *bignum_mul(BIGNUM *n1, BIGNUM *n2)
             for (; j < n2_len - 1 + LEN_BYTE; ++j) {
                 int tmp = (digit & (*(n2 + j) - '0')) + (*(res + i + j - LEN_BYTE) - '0') + carry;
 
-                carry = 0;
-                if (tmp >= 2) {
-                    carry = 1;
-                    tmp -= 2;
-                }
+                carry = tmp >> 1;
+                tmp &= 1;
                 *(res + i + j - LEN_BYTE) = tmp + '0';
             }
             
@@ -207,6 +764,9 @@ BIGNUM *bignum_mul(BIGNUM *n1, BIGNUM *n2)
 BIGNUM *bignum_lshift(BIGNUM *n, int offset)
 {
     BIGNUM *res = bignum_new(GET_LEN(n) + offset);
+    if (!res) {
+        return NULL;
+    }
 
     for (int i = LEN_BYTE; i < GET_LEN(n) - 1 + LEN_BYTE; ++i) {
         *(res + i + offset) = *(n + i);
@@ -220,29 +780,24 @@ BIGNUM *bignum_sub(BIGNUM *n1, BIGNUM *n2)
     int n1_len = GET_LEN(n1);
     int n2_len = GET_LEN(n2);
     BIGNUM *neg_n1 = bignum_new(n2_len);
+    if (!neg_n1) {
+        return NULL;
+    }
 
     int carry = 1;
     int i = LEN_BYTE;
     for (; i < LEN_BYTE + n1_len - 1; ++i) {
         int tmp = ((*(n1 + i) - '0') ^ 1) + (*(n2 + i) - '0') + carry;
-        carry = 0;
-
-        if (tmp >= 2) {
-            carry = 1;
-            tmp -= 2;
-        }
+        carry = tmp >> 1;
+        tmp &= 1;
 
         *(neg_n1 + i) = tmp + '0';
     }
 
     for (; i < LEN_BYTE + n2_len - 1; ++i) {
         int tmp = (*(n2 + i) - '0') + 1 + carry;
-        carry = 0;
-
-        if (tmp >= 2) {
-            carry = 1;
-            tmp -= 2;
-        }
+        carry = tmp >> 1;
+        tmp &= 1;
         
         *(neg_n1 + i) = tmp + '0';
     }
@@ -260,20 +815,31 @@ BIGNUM *bignum_sub(BIGNUM *n1, BIGNUM *n2)
     return neg_n1;
 }
 
-BIGNUM *bignum_fast_doubling_clz(long long n)
+BIGNUM *bignum_fast_doubling_clz(long long n, struct fib_progress *progress)
 {
     BIGNUM *a = bignum_new(2);
     BIGNUM *b = bignum_new(2);
+    if (!a || !b) {
+        FREE_BIGNUM(a);
+        FREE_BIGNUM(b);
+        return NULL;
+    }
     *(b + LEN_BYTE) = '1';
 
     for (unsigned long long i = 1 << (31 - __builtin_clzll(n)); i; i >>= 1) {
+        if (fib_progress(progress, fls64(n) - fls64(i) + 1)) {
+            FREE_BIGNUM(a);
+            FREE_BIGNUM(b);
+            return NULL;
+        }
+
         BIGNUM *double_b = bignum_lshift(b, 1);
-        BIGNUM *db_minus_a = bignum_sub(a, double_b);
-        BIGNUM *t1 = bignum_mul(a, db_minus_a);
+        BIGNUM *db_minus_a = double_b ? bignum_sub(a, double_b) : NULL;
+        BIGNUM *t1 = db_minus_a ? bignum_mul(a, db_minus_a) : NULL;
 
         BIGNUM *a_square = bignum_mul(a, a);
         BIGNUM *b_square = bignum_mul(b, b);
-        BIGNUM *t2 = bignum_add(a_square, b_square);
+        BIGNUM *t2 = (a_square && b_square) ? bignum_add(a_square, b_square) : NULL;
 
         FREE_BIGNUM(a);
         FREE_BIGNUM(b);
@@ -282,10 +848,20 @@ BIGNUM *bignum_fast_doubling_clz(long long n)
         FREE_BIGNUM(a_square);
         FREE_BIGNUM(b_square);
 
+        if (!t1 || !t2) {
+            FREE_BIGNUM(t1);
+            FREE_BIGNUM(t2);
+            return NULL;
+        }
+
         if ((n & i) != 0) {
             a = t2;
             b = bignum_add(t1, t2);
             FREE_BIGNUM(t1);
+            if (!b) {
+                FREE_BIGNUM(a);
+                return NULL;
+            }
         }
         else {
             a = t1;
@@ -325,8 +901,15 @@ typedef struct binary_big_num
  */
 bignum_bin *bignum_bin_new(int len)
 {
-    bignum_bin *num = (bignum_bin *)kmalloc(sizeof(bignum_bin), GFP_KERNEL);
-    num->number = (char *)kmalloc(sizeof(char) * len, GFP_KERNEL);
+    bignum_bin *num = (bignum_bin *)fib_alloc(sizeof(bignum_bin));
+    if (!num) {
+        return NULL;
+    }
+    num->number = (char *)fib_alloc(sizeof(char) * len);
+    if (!num->number) {
+        fib_free(num);
+        return NULL;
+    }
     num->len = len;
 
     for (int i = 0; i < num->len - 1; i++) {
@@ -339,24 +922,25 @@ bignum_bin *bignum_bin_new(int len)
 
 void bignum_bin_free(bignum_bin *num)
 {
-    kfree(num->number);
-    kfree(num);
+    if (!num) {
+        return;
+    }
+    fib_free(num->number);
+    fib_free(num);
 }
 
 bignum_bin *bignum_bin_add(bignum_bin *num1, bignum_bin *num2)
 {
     bignum_bin *res = bignum_bin_new(num2->len + 1);
+    if (!res) {
+        return NULL;
+    }
 
     int idx = 0, carry = 0;
     while (idx <= (num1->len - 2)) {
         int sum = (int)(num1->number[idx] - '0') + (int)(num2->number[idx] - '0') + carry;
-        carry = 0;
-        
-        if (sum >= 2)
-        {
-            sum -= 2;
-            carry = 1;
-        }
+        carry = sum >> 1;
+        sum &= 1;
 
         res->number[idx] = (char)(sum + '0');
         idx++;
@@ -364,13 +948,8 @@ bignum_bin *bignum_bin_add(bignum_bin *num1, bignum_bin *num2)
 
     while (idx <= (num2->len -2)) {
         int sum = (int)(num2->number[idx] - '0') + carry;
-        carry = 0;
-        
-        if (sum >= 2)
-        {
-            sum -= 2;
-            carry = 1;
-        }
+        carry = sum >> 1;
+        sum &= 1;
 
         res->number[idx] = (char)(sum + '0');
         idx++;
@@ -388,10 +967,53 @@ bignum_bin *bignum_bin_add(bignum_bin *num1, bignum_bin *num2)
     return res;
 }
 
-bignum_bin *bignum_bin_fibonacci(long long k)
+/*
+ * function that performs num1 += num2 in place
+ * @num1: num1 must be <= num2, its buffer is grown to hold the sum
+ * return: 0, or -ENOMEM if the buffer cannot grow (num1 is left untouched)
+ */
+int bignum_bin_add_to(bignum_bin *num1, bignum_bin *num2)
+{
+    char *number = (char *)fib_realloc(num1->number, num2->len + 1);
+    if (!number) {
+        return -ENOMEM;
+    }
+    num1->number = number;
+
+    /* pad num1 with '0' up to the digits of num2 */
+    for (int i = num1->len - 1; i < num2->len - 1; ++i) {
+        number[i] = '0';
+    }
+
+    int idx = 0, carry = 0;
+    while (idx <= (num2->len - 2)) {
+        int sum = (int)(number[idx] - '0') + (int)(num2->number[idx] - '0') + carry;
+        carry = sum >> 1;
+        sum &= 1;
+
+        number[idx] = (char)(sum + '0');
+        idx++;
+    }
+
+    if (carry == 1) {
+        number[idx++] = '1';
+    }
+
+    number[idx] = '\0';
+    num1->len = idx + 1;
+
+    return 0;
+}
+
+bignum_bin *bignum_bin_fibonacci(long long k, struct fib_progress *progress)
 {
     bignum_bin *a = bignum_bin_new(2);
     bignum_bin *b = bignum_bin_new(2);
+    if (!a || !b) {
+        bignum_bin_free(a);
+        bignum_bin_free(b);
+        return NULL;
+    }
     b->number[0] = '1';
     bignum_bin *sum;
 
@@ -405,8 +1027,13 @@ bignum_bin *bignum_bin_fibonacci(long long k)
     }
 
     for (int i = 2; i <= k; ++i) {
-        sum = bignum_bin_add(a, b);
-        bignum_bin_free(a);
+        /* a + b is accumulated into the buffer of a, which becomes the new b */
+        if (((i & 0x3ff) == 0 && fib_progress(progress, i)) || bignum_bin_add_to(a, b)) {
+            bignum_bin_free(a);
+            bignum_bin_free(b);
+            return NULL;
+        }
+        sum = a;
         a = b;
         b = sum;
     }
@@ -423,12 +1050,19 @@ char *bignum_bin_to_decimal(const bignum_bin *binary)
      */
     size_t len = (binary->len/3) + 2;
 
-    char *decimal = (char *)kmalloc(len, GFP_KERNEL);
-    
+    char *decimal = (char *)fib_alloc(len);
+    if (!decimal) {
+        return NULL;
+    }
+
     memset(decimal, '0', len);
 
     /* convert binary to decimal */
     for (int i = binary->len - 2; i >= 0; --i) {
+        if ((i & 0x3ff) == 0 && fib_should_stop()) {
+            fib_free(decimal);
+            return NULL;
+        }
         int digit = binary->number[i] - '0';
 
         for (int j = 0; j < len; ++j) {
@@ -438,15 +1072,15 @@ char *bignum_bin_to_decimal(const bignum_bin *binary)
         }
     }
 
-    /* find the correct position for null terminator */
-    int idx = len - 1;
-    for (int i = len - 1; i >= 0; --i) {
+    /* find the correct position for null terminator, F(0) keeps a single "0" */
+    int idx = 1;
+    for (int i = len - 1; i > 1; --i) {
         if (decimal[i - 1] != '0') {
-            decimal[i] = '\0';
             idx = i;
             break;
         }
     }
+    decimal[idx] = '\0';
 
     /* reverse the string */
     for (int i = 0; i < idx/2; ++i) {
@@ -468,6 +1102,9 @@ bignum_bin *bignum_bin_mul(bignum_bin *num1, bignum_bin *num2) {
      * (num1->len - 1) + (num2->len - 1) + 1
      */
     bignum_bin *res = bignum_bin_new((num1->len - 1) + (num2->len - 1) + 1);
+    if (!res) {
+        return NULL;
+    }
 
     /* 
      *      num2
@@ -477,6 +1114,11 @@ bignum_bin *bignum_bin_mul(bignum_bin *num1, bignum_bin *num2) {
 
     /* do the multiplication */
     for (int i = 0; i < num1->len - 1; ++i) {
+        if ((i & 0x3ff) == 0x3ff && fib_should_stop()) {
+            bignum_bin_free(res);
+            return NULL;
+        }
+
         /* 
          * if the current digit of num1->number[i] is '0'
          * we can skip this digit
@@ -489,11 +1131,8 @@ bignum_bin *bignum_bin_mul(bignum_bin *num1, bignum_bin *num2) {
             int j = 0;
             for (; j < num2->len - 1; ++j) {
                 int tmp = (digit & (num2->number[j] - '0')) + (res->number[i + j] - '0') + carry;
-                carry = 0;
-                if (tmp >= 2) {
-                    carry = 1;
-                    tmp %= 2;
-                }
+                carry = tmp >> 1;
+                tmp &= 1;
                 res->number[i + j] = tmp + '0';
             }
 
@@ -523,6 +1162,9 @@ bignum_bin *bignum_bin_mul(bignum_bin *num1, bignum_bin *num2) {
 bignum_bin *bignum_bin_lshift(bignum_bin *num, int offset)
 {
     bignum_bin *res = bignum_bin_new(num->len + offset);
+    if (!res) {
+        return NULL;
+    }
 
     for (int i = 0; i < num->len - 1; ++i) {
         res->number[i + offset] = num->number[i];
@@ -551,6 +1193,9 @@ bignum_bin *bignum_bin_sub(bignum_bin *num1, bignum_bin *num2)
      * the rest of the digit will be filled with 1s for representing negative number
      */
     bignum_bin *neg_num1 = bignum_bin_new(num2->len);
+    if (!neg_num1) {
+        return NULL;
+    }
     /* ex. 11000 (24) - 11 (3)
      * in this case, the binary form of -3 is 11101 (-16 + 8 + 4 + 1 = -3)
      */
@@ -563,12 +1208,8 @@ bignum_bin *bignum_bin_sub(bignum_bin *num1, bignum_bin *num2)
     int i = 0;
     for (; i < num1->len - 1; ++i) {
         int tmp = ((num1->number[i] - '0') ^ 1) + (num2->number[i] - '0') + carry;
-        carry = 0;
-
-        if (tmp >= 2) {
-            carry = 1;
-            tmp -= 2;
-        }
+        carry = tmp >> 1;
+        tmp &= 1;
 
         neg_num1->number[i] = tmp + '0';
     }
@@ -577,12 +1218,8 @@ bignum_bin *bignum_bin_sub(bignum_bin *num1, bignum_bin *num2)
     // for representing negative number
     for (; i < num2->len - 1; ++i) {
         int tmp = (num2->number[i] - '0') + 1 + carry;
-        carry = 0;
-
-        if (tmp >= 2) {
-            carry = 1;
-            tmp -= 2;
-        }
+        carry = tmp >> 1;
+        tmp &= 1;
         neg_num1->number[i] = tmp + '0';
     }
     neg_num1->number[i] = '\0';
@@ -608,6 +1245,9 @@ bignum_bin *bignum_bin_new_with_num(long long int n)
 {
     int len = (31 - __builtin_clz(n)) + 1;
     bignum_bin *num = bignum_bin_new(len);
+    if (!num) {
+        return NULL;
+    }
 
     long long mask = 1;
     for (int i = 0; i < len - 1; ++i) {
@@ -621,22 +1261,33 @@ bignum_bin *bignum_bin_new_with_num(long long int n)
     return num;
 }
 
-bignum_bin *bignum_bin_fast_doubling(long long n)
+bignum_bin *bignum_bin_fast_doubling(long long n, struct fib_progress *progress)
 {
     bignum_bin *a = bignum_bin_new(2);
     bignum_bin *b = bignum_bin_new(2);
+    if (!a || !b) {
+        bignum_bin_free(a);
+        bignum_bin_free(b);
+        return NULL;
+    }
     b->number[0] = '1';
 
     for (unsigned int i = (1 << 31); i; i >>= 1) {
+        if (fib_progress(progress, 32 - fls(i) + 1)) {
+            bignum_bin_free(a);
+            bignum_bin_free(b);
+            return NULL;
+        }
+
         /* calculate t1 */
         bignum_bin *double_b = bignum_bin_lshift(b, 1);
-        bignum_bin *db_minus_a = bignum_bin_sub(a, double_b);
-        bignum_bin *t1 = bignum_bin_mul(a, db_minus_a);
+        bignum_bin *db_minus_a = double_b ? bignum_bin_sub(a, double_b) : NULL;
+        bignum_bin *t1 = db_minus_a ? bignum_bin_mul(a, db_minus_a) : NULL;
 
         /* calculate t2 */
         bignum_bin *a_square = bignum_bin_mul(a, a);
         bignum_bin *b_square = bignum_bin_mul(b, b);
-        bignum_bin *t2 = bignum_bin_add(a_square, b_square);
+        bignum_bin *t2 = (a_square && b_square) ? bignum_bin_add(a_square, b_square) : NULL;
 
         bignum_bin_free(a);
         bignum_bin_free(b);
@@ -644,11 +1295,21 @@ bignum_bin *bignum_bin_fast_doubling(long long n)
         bignum_bin_free(db_minus_a);
         bignum_bin_free(a_square);
         bignum_bin_free(b_square);
+
+        if (!t1 || !t2) {
+            bignum_bin_free(t1);
+            bignum_bin_free(t2);
+            return NULL;
+        }
         
         if ((n & i) != 0) {
             a = t2;
             b = bignum_bin_add(t1, t2);
             bignum_bin_free(t1);
+            if (!b) {
+                bignum_bin_free(a);
+                return NULL;
+            }
         }
         else {
             a = t1;
@@ -660,22 +1321,33 @@ bignum_bin *bignum_bin_fast_doubling(long long n)
     return a;
 }
 
-bignum_bin *bignum_bin_fast_doubling_clz(long long n)
+bignum_bin *bignum_bin_fast_doubling_clz(long long n, struct fib_progress *progress)
 {
     bignum_bin *a = bignum_bin_new(2);
     bignum_bin *b = bignum_bin_new(2);
+    if (!a || !b) {
+        bignum_bin_free(a);
+        bignum_bin_free(b);
+        return NULL;
+    }
     b->number[0] = '1';
 
     for (unsigned long long i = 1 << (31 - __builtin_clzll(n)); i; i >>= 1) {
+        if (fib_progress(progress, fls64(n) - fls64(i) + 1)) {
+            bignum_bin_free(a);
+            bignum_bin_free(b);
+            return NULL;
+        }
+
         /* calculate t1 */
         bignum_bin *double_b = bignum_bin_lshift(b, 1);
-        bignum_bin *db_minus_a = bignum_bin_sub(a, double_b);
-        bignum_bin *t1 = bignum_bin_mul(a, db_minus_a);
+        bignum_bin *db_minus_a = double_b ? bignum_bin_sub(a, double_b) : NULL;
+        bignum_bin *t1 = db_minus_a ? bignum_bin_mul(a, db_minus_a) : NULL;
 
         /* calculate t2 */
         bignum_bin *a_square = bignum_bin_mul(a, a);
         bignum_bin *b_square = bignum_bin_mul(b, b);
-        bignum_bin *t2 = bignum_bin_add(a_square, b_square);
+        bignum_bin *t2 = (a_square && b_square) ? bignum_bin_add(a_square, b_square) : NULL;
 
         bignum_bin_free(a);
         bignum_bin_free(b);
@@ -683,11 +1355,21 @@ bignum_bin *bignum_bin_fast_doubling_clz(long long n)
         bignum_bin_free(db_minus_a);
         bignum_bin_free(a_square);
         bignum_bin_free(b_square);
+
+        if (!t1 || !t2) {
+            bignum_bin_free(t1);
+            bignum_bin_free(t2);
+            return NULL;
+        }
         
         if ((n & i) != 0) {
             a = t2;
             b = bignum_bin_add(t1, t2);
             bignum_bin_free(t1);
+            if (!b) {
+                bignum_bin_free(a);
+                return NULL;
+            }
         }
         else {
             a = t1;
@@ -717,12 +1399,19 @@ typedef struct bignum_decimal
 
 /* function to dynamically allocate a new bignum_decimal
  * @len: the digits of the number to create plus null terminator
- * return: a pointer to bignum_decimal
+ * return: a pointer to bignum_decimal, or NULL when out of memory
  */
 bignum_decimal *new_bignum_decimal(int len) 
 {
-    bignum_decimal *new_num = (bignum_decimal *)kmalloc(sizeof(bignum_decimal), GFP_KERNEL);
-    new_num->number = (char *)kmalloc(sizeof(char) * len, GFP_KERNEL);
+    bignum_decimal *new_num = (bignum_decimal *)fib_alloc(sizeof(bignum_decimal));
+    if (!new_num) {
+        return NULL;
+    }
+    new_num->number = (char *)fib_alloc(sizeof(char) * len);
+    if (!new_num->number) {
+        fib_free(new_num);
+        return NULL;
+    }
     new_num->len = len;
 
     for (int i = 0; i < len; ++i) {
@@ -737,8 +1426,11 @@ bignum_decimal *new_bignum_decimal(int len)
  */
 void free_bignum_decimal(bignum_decimal *num)
 {
-    kfree(num->number);
-    kfree(num);
+    if (!num) {
+        return;
+    }
+    fib_free(num->number);
+    fib_free(num);
 }
 
 /* function to add 2 bignum_decimal
@@ -747,6 +1439,9 @@ void free_bignum_decimal(bignum_decimal *num)
 bignum_decimal *add_two_bignum_decimal(bignum_decimal *num1, bignum_decimal *num2)
 {
     bignum_decimal *res = new_bignum_decimal(num2->len + 1);
+    if (!res) {
+        return NULL;
+    }
     /* assume the result carries, so the length is (num2->len + 1)
     * if no carry, the length will be corrected lastly
     */
@@ -756,12 +1451,8 @@ bignum_decimal *add_two_bignum_decimal(bignum_decimal *num1, bignum_decimal *num
    
    while (idx <= (num1->len - 2)) {
        int tmp = (int)(num1->number[idx] - '0') + (int)(num2->number[idx] - '0') + carry;
-       carry = 0;
-
-       if (tmp >= 10) {
-           tmp -= 10;
-           carry = 1;
-       }
+       carry = tmp >= 10;
+       tmp -= carry * 10;
 
        res->number[idx] = (char)(tmp + '0');
        idx++;
@@ -769,12 +1460,8 @@ bignum_decimal *add_two_bignum_decimal(bignum_decimal *num1, bignum_decimal *num
 
    while (idx <= (num2->len - 2)) {
         int tmp = (int)(num2->number[idx] - '0') + carry;
-        carry = 0;
-
-        if (tmp >= 10) {
-            tmp -= 10;
-            carry = 1;
-        }
+        carry = tmp >= 10;
+        tmp -= carry * 10;
 
         res->number[idx] = (char)(tmp + '0');
         idx++;
@@ -792,10 +1479,52 @@ bignum_decimal *add_two_bignum_decimal(bignum_decimal *num1, bignum_decimal *num
    return res;
 }
 
-bignum_decimal *bignum_decimal_fibonacci(long long k)
+/* function that performs num1 += num2 in place
+ * @num2 must be bigger than num1, the buffer of num1 is grown to hold the sum
+ * return: 0, or -ENOMEM if the buffer cannot grow (num1 is left untouched)
+ */
+int add_to_bignum_decimal(bignum_decimal *num1, bignum_decimal *num2)
+{
+    char *number = (char *)fib_realloc(num1->number, num2->len + 1);
+    if (!number) {
+        return -ENOMEM;
+    }
+    num1->number = number;
+
+    /* pad num1 with '0' up to the digits of num2 */
+    for (int i = num1->len - 1; i < num2->len - 1; ++i) {
+        number[i] = '0';
+    }
+
+    int idx = 0, carry = 0;
+    while (idx <= (num2->len - 2)) {
+        int tmp = (int)(number[idx] - '0') + (int)(num2->number[idx] - '0') + carry;
+        carry = tmp >= 10;
+        tmp -= carry * 10;
+
+        number[idx] = (char)(tmp + '0');
+        idx++;
+    }
+
+    if (carry == 1) {
+        number[idx++] = '1';
+    }
+
+    number[idx] = '\0';
+    num1->len = idx + 1;
+
+    return 0;
+}
+
+bignum_decimal *bignum_decimal_fibonacci(long long k, struct fib_progress *progress)
 {
     bignum_decimal *num1 = new_bignum_decimal(2);
     bignum_decimal *num2 = new_bignum_decimal(2);
+    if (!num1 || !num2) {
+        free_bignum_decimal(num1);
+        free_bignum_decimal(num2);
+        return NULL;
+    }
     num2->number[0] = '1';
     bignum_decimal *sum;
 
@@ -809,8 +1538,14 @@ bignum_decimal *bignum_decimal_fibonacci(long long k)
     }
 
     for (int i = 2; i <= k; ++i) {
-        sum = add_two_bignum_decimal(num1, num2);
-        free_bignum_decimal(num1);
+        /* num1 + num2 is accumulated into num1, which becomes the new num2 */
+        if (((i & 0x3ff) == 0 && fib_progress(progress, i)) ||
+            add_to_bignum_decimal(num1, num2)) {
+            free_bignum_decimal(num1);
+            free_bignum_decimal(num2);
+            return NULL;
+        }
+        sum = num1;
         num1 = num2;
         num2 = sum;
     }
@@ -832,249 +1567,2929 @@ char *reverse_bignum_decimal_string(bignum_decimal *n)
 }
 
 
-static long long fib_sequence(long long k)
+/* bignum_limb struct definition */
+typedef struct bignum_limb
 {
-    /* if F0 or F1, then return F0 or F1 */
-    if (k < 2) {
-        return k;
-    }
+    int size;       /* the number of limbs in use, at least 1 */
+    int cap;        /* the number of limbs allocated */
+    u64 *limb;      /* little-endian, limb[0] is the least significant */
+} bignum_limb;
+/*
+ * bignum_limb is the packed form used by the hex and raw output formats.
+ * Converting bignum_bin or BIGNUM into it takes a single pass over the
+ * bits, so these formats skip the quadratic decimal conversion entirely.
+ */
 
-    /* F0 = 0 = n1
-     * F1 = 1 = n2
-     * F2 = 1 = n3
-     */
-    long long n1 = 0, n2 = 1, n3 = 1;
-    
-    for (int i = 2; i <= k; ++i) {
-        n3 = n1 + n2;
-        n1 = n2;
-        n2 = n3;
+/*
+ * function to create a new bignum_limb with all limbs set to 0
+ * @size: the number of limbs
+ */
+bignum_limb *bignum_limb_new(int size)
+{
+    bignum_limb *num = (bignum_limb *)fib_alloc(sizeof(bignum_limb));
+    if (!num) {
+        return NULL;
     }
+    num->limb = (u64 *)fib_alloc(sizeof(u64) * size);
+    if (!num->limb) {
+        fib_free(num);
+        return NULL;
+    }
+    memset(num->limb, 0, sizeof(u64) * size);
+    num->size = size;
+    num->cap = size;
 
-    return n2;
+    return num;
 }
 
-/* function that calculates fibonacci number using fast doubling
- */
-static unsigned long long fast_doubling(long long n)
+void bignum_limb_free(bignum_limb *num)
 {
-    long long a = 0, b = 1;
-
-    for (unsigned int i = 1U << 31; i; i >>= 1)
-    {
-        long long t1 = a * (2 * b - a);
-        long long t2 = a * a + b * b;
-
-        if ((n & i) != 0)
-        {
-            a = t2;
-            b = t1 + t2;
-        } else
-        {
-            a = t1;
-            b = t2;
-        }
+    if (!num) {
+        return;
     }
-    
-    return a;
+    fib_free(num->limb);
+    fib_free(num);
 }
 
-/* function that calculates fibonacci number using fast doubling
- * with clz for speeding up
+/*
+ * function that packs a char array of '0'/'1' into limbs
+ * @bits: the binary digits, least significant first
+ * @nbits: how many digits in @bits
  */
-static long long fast_doubling_clz(long long n)
+static bignum_limb *bits_to_limb(const char *bits, int nbits)
 {
-    long long a = 0, b = 1;
-
-    for (unsigned int i = (1U << (31 - __builtin_clz(n))); i; i >>= 1)
-    {
-        long long t1 = a * (2 * b - a);
-        long long t2 = a * a + b * b;
+    bignum_limb *num = bignum_limb_new(nbits > 0 ? DIV_ROUND_UP(nbits, 64) : 1);
+    if (!num) {
+        return NULL;
+    }
 
-        if ((n & i) != 0)
-        {
-            a = t2;
-            b = t1 + t2;
-        } else
-        {
-            a = t1;
-            b = t2;
+    for (int i = 0; i < nbits; ++i) {
+        if (bits[i] == '1') {
+            num->limb[i >> 6] |= 1ULL << (i & 63);
         }
     }
 
-    return a;
+    /* drop the leading zero limbs */
+    while (num->size > 1 && num->limb[num->size - 1] == 0) {
+        num->size--;
+    }
+
+    return num;
 }
 
-static int fib_open(struct inode *inode, struct file *file)
+bignum_limb *bignum_bin_to_limb(const bignum_bin *num)
 {
-    if (!mutex_trylock(&fib_mutex)) {
-        printk(KERN_ALERT "fibdrv is in use\n");
-        return -EBUSY;
-    }
-    return 0;
+    return bits_to_limb(num->number, num->len - 1);
 }
 
-static int fib_release(struct inode *inode, struct file *file)
+bignum_limb *bignum_to_limb(const BIGNUM *num)
 {
-    mutex_unlock(&fib_mutex);
-    return 0;
+    return bits_to_limb(num + LEN_BYTE, GET_LEN(num) - 1);
 }
 
-/* calculate the fibonacci number at given offset */
-static ssize_t fib_read(struct file *file,
-                        char *buf,
-                        size_t size,
-                        loff_t *offset)
+/*
+ * function that converts a bignum_decimal into limbs
+ * the digits are consumed 19 at a time from the most significant one,
+ * and each chunk is folded in by limbs = limbs * 10^19 + chunk
+ */
+bignum_limb *bignum_decimal_to_limb(const bignum_decimal *num)
 {
-    char *fib_num = NULL;
-    if (size == 0) {
-        return (ssize_t) fib_sequence(*offset);
-    }
-    else if (size == 1) {
-        return (ssize_t) fast_doubling(*offset);
-    }
-    else if (size == 2) {
-        return (ssize_t) fast_doubling_clz(*offset);
-    }
-    else if (size == 3) {
-        bignum_decimal *num = bignum_decimal_fibonacci(*offset);
-        fib_num = reverse_bignum_decimal_string(num);
+    int digits = num->len - 1;
+    /* a decimal digit is approximately 3.33 binary digits */
+    bignum_limb *res = bignum_limb_new(digits / 19 + 2);
+    if (!res) {
+        return NULL;
     }
-    else if (size == 4) {
-        bignum_bin *num = bignum_bin_fibonacci(*offset);
-        fib_num = bignum_bin_to_decimal(num);
+    int used = 1;
+
+    int i = digits - 1;
+    while (i >= 0) {
+        if (fib_should_stop()) {
+            bignum_limb_free(res);
+            return NULL;
+        }
+
+        u64 chunk = 0, mul = 1;
+        for (int j = 0; j < 19 && i >= 0; ++j, --i) {
+            chunk = chunk * 10 + (num->number[i] - '0');
+            mul *= 10;
+        }
+
+        u64 carry = chunk;
+        for (int j = 0; j < used; ++j) {
+            unsigned __int128 t = (unsigned __int128) res->limb[j] * mul + carry;
+            res->limb[j] = (u64) t;
+            carry = (u64) (t >> 64);
+        }
+        if (carry) {
+            res->limb[used++] = carry;
+        }
     }
-    else if (size == 5) {
-        bignum_bin *num = bignum_bin_fast_doubling(*offset);
-        fib_num = bignum_bin_to_decimal(num);
+    res->size = used;
+
+    return res;
+}
+
+/*
+ * function that writes a bignum_limb as a lowercase hex string
+ * most significant digit first, without leading zeros
+ * @hex: the destination, at least num->size * 16 + 1 bytes
+ * return: the length of the string, excluding the null terminator
+ */
+int bignum_limb_to_hex(const bignum_limb *num, char *hex)
+{
+    static const char hex_digit[] = "0123456789abcdef";
+    u64 top = num->limb[num->size - 1];
+
+    /* the top limb is printed without leading zeros */
+    int idx = 0;
+    int shift = top ? (fls64(top) - 1) & ~3 : 0;
+    for (; shift >= 0; shift -= 4) {
+        hex[idx++] = hex_digit[(top >> shift) & 0xf];
     }
-    else if (size == 6) {
-        bignum_bin *num = bignum_bin_fast_doubling_clz(*offset);
-        fib_num = bignum_bin_to_decimal(num);
+
+    for (int i = num->size - 2; i >= 0; --i) {
+        for (shift = 60; shift >= 0; shift -= 4) {
+            hex[idx++] = hex_digit[(num->limb[i] >> shift) & 0xf];
+        }
     }
-    else if (size == 7) {
-        BIGNUM *num = bignum_fast_doubling_clz(*offset);
-        fib_num = bignum_to_decimal(num);
+    hex[idx] = '\0';
+
+    return idx;
+}
+
+/*
+ * function that writes the limbs of a bignum_limb as little-endian bytes
+ * @raw: the destination, at least num->size * 8 bytes
+ */
+void bignum_limb_to_raw(const bignum_limb *num, char *raw)
+{
+    __le64 *dst = (__le64 *)raw;
+
+    for (int i = 0; i < num->size; ++i) {
+        dst[i] = cpu_to_le64(num->limb[i]);
     }
-    else {
+}
+
+/*
+ * limb arithmetic
+ *
+ * The operands are normalized, i.e. without leading zero limbs above
+ * limb[0], and so are the results. A destination grows as needed and may be
+ * one of the sources of add and sub, but never of mul.
+ * return: 0, -ENOMEM, or -EINTR if the caller was killed meanwhile
+ */
+
+/* make room for @size limbs in @num, keeping its value */
+static int bignum_limb_reserve(bignum_limb *num, int size)
+{
+    if (size <= num->cap) {
         return 0;
     }
-    
-    ssize_t len = strlen(fib_num) + 1;
-    ssize_t retval = copy_to_user(buf, fib_num, len);
-    if (retval == 0) {
-        retval = len;
+
+    u64 *limb = (u64 *)fib_realloc(num->limb, sizeof(u64) * size);
+    if (!limb) {
+        return -ENOMEM;
     }
-    else {
-        retval = -EFAULT;
+    num->limb = limb;
+    num->cap = size;
+
+    return 0;
+}
+
+static inline void bignum_limb_normalize(bignum_limb *num)
+{
+    while (num->size > 1 && num->limb[num->size - 1] == 0) {
+        num->size--;
     }
-    
-    return retval;
 }
 
-static ssize_t fib_write(struct file *file,
-                         const char *buf,
-                         size_t size,
-                         loff_t *offset)
+/* @num = @value, @num has at least one limb */
+static inline void bignum_limb_set(bignum_limb *num, u64 value)
 {
-    ktime_t start_time, end_time;
-    s64 elapsed_time;
+    num->limb[0] = value;
+    num->size = 1;
+}
 
-    if (size == 0) {
-        /* test the execution time of iterative version of fibonacci number */
-        start_time = ktime_get();
-        fib_sequence(*offset);
-        end_time = ktime_get();
-    } else if (size == 1) {
-        /* test the execution time of fast doubling version */
-        start_time = ktime_get();
-        fast_doubling(*offset);
-        end_time = ktime_get();
-    } else if (size == 2) {
-        /* test the execution time of fast doubling version using clz */
-        start_time = ktime_get();
-        fast_doubling_clz(*offset);
-        end_time = ktime_get();
-    } else if (size == 3) {
-        /* test the execution time of bignum_decimal */
-        start_time = ktime_get();
-        bignum_decimal *num = bignum_decimal_fibonacci(*offset);
-        char *fib_num = reverse_bignum_decimal_string(num);
-        end_time = ktime_get();
-    } else if (size == 4) {
-        /* test the execution time of bignum_bin_fibonacci
-         * the iterative version of fibonacci
-         */
-        start_time = ktime_get();
-        bignum_bin *num = bignum_bin_fibonacci(*offset);
-        char *fib_num = bignum_bin_to_decimal(num);
-        end_time = ktime_get();
-    } else if (size == 5) {
-        /* test the execution time of bignum_bin_fast_doubling_clz */
-        start_time = ktime_get();
-        bignum_bin *num = bignum_bin_fast_doubling(*offset);
-        char *fib_num = bignum_bin_to_decimal(num);
-        end_time = ktime_get();
-    } else if (size == 6) {
-        /* test the execution time of bignum_bin_fast_doubling_clz */
-        start_time = ktime_get();
-        bignum_bin *num = bignum_bin_fast_doubling_clz(*offset);
-        char *fib_num = bignum_bin_to_decimal(num);
-        end_time = ktime_get();
-    } else if (size == 7) {
-        /* test the execution time of bignum_fast_doubling_clz */
-        start_time = ktime_get();
-        BIGNUM *num = bignum_fast_doubling_clz(*offset);
-        char *fib_num = bignum_to_decimal(num);
-        end_time = ktime_get();
+static int bignum_limb_copy(bignum_limb *dst, const bignum_limb *src)
+{
+    if (bignum_limb_reserve(dst, src->size)) {
+        return -ENOMEM;
     }
-    
-    elapsed_time = ktime_to_ns(ktime_sub(end_time, start_time));
-    return elapsed_time;
+    memcpy(dst->limb, src->limb, sizeof(u64) * src->size);
+    dst->size = src->size;
+
+    return 0;
 }
 
-static loff_t fib_device_lseek(struct file *file, loff_t offset, int orig)
+/* @res = @a + @b */
+int bignum_limb_add(bignum_limb *res, const bignum_limb *a, const bignum_limb *b)
 {
-    loff_t new_pos = 0;
-    switch (orig) {
-    case 0: /* SEEK_SET: */
-        new_pos = offset;
-        break;
-    case 1: /* SEEK_CUR: */
-        new_pos = file->f_pos + offset;
-        break;
-    case 2: /* SEEK_END: */
-        new_pos = MAX_LENGTH - offset;
-        break;
+    if (a->size < b->size) {
+        swap(a, b);
+    }
+    int n = a->size, m = b->size;
+    if (bignum_limb_reserve(res, n + 1)) {
+        return -ENOMEM;
     }
 
-    if (new_pos > MAX_LENGTH)
-        new_pos = MAX_LENGTH;  // max case
-    if (new_pos < 0)
-        new_pos = 0;        // min case
-    file->f_pos = new_pos;  // This is what we'll use now
-    return new_pos;
-}
+    u64 carry = bn_add_n(res->limb, a->limb, b->limb, m);
+    carry = bn_add_1(res->limb + m, a->limb + m, n - m, carry);
+    res->limb[n] = carry;
+    res->size = n + carry;
 
-const struct file_operations fib_fops = {
-    .owner = THIS_MODULE,
-    .read = fib_read,
-    .write = fib_write,
-    .open = fib_open,
-    .release = fib_release,
-    .llseek = fib_device_lseek,
-};
+    return 0;
+}
 
-static int __init init_fib_dev(void)
+/* @res = @a - @b, where @a >= @b */
+int bignum_limb_sub(bignum_limb *res, const bignum_limb *a, const bignum_limb *b)
 {
-    int rc = 0;
-    mutex_init(&fib_mutex);
+    int n = a->size, m = b->size;
+    if (bignum_limb_reserve(res, n)) {
+        return -ENOMEM;
+    }
 
-    // Let's register the device
-    // This will dynamically allocate the major number
-    rc = major = register_chrdev(major, DEV_FIBONACCI_NAME, &fib_fops);
-    if (rc < 0) {
-        printk(KERN_ALERT "Failed to add cdev\n");
+    u64 borrow = bn_sub_n(res->limb, a->limb, b->limb, m);
+    bn_sub_1(res->limb + m, a->limb + m, n - m, borrow);
+    res->size = n;
+    bignum_limb_normalize(res);
+
+    return 0;
+}
+
+/*
+ * the widest operands handed to the fixed width kernels
+ * They only win when the compiler keeps their accumulators in registers,
+ * which is why the Makefile builds fibdrv.o with -O2. Built at -O0 every
+ * partial product goes through the stack, and bench_kernels mul at -O0 has
+ * them behind the row loops at nearly every width, so they are left out.
+ */
+#ifdef __OPTIMIZE__
+#define BN_FIXED_USE BN_FIXED_MAX
+#else
+#define BN_FIXED_USE 0
+#endif
+
+/*
+ * @res = @a * @b, schoolbook
+ * operands up to BN_FIXED_USE limbs that are within a limb of each other,
+ * as the neighbours of the sequence are, take the fixed width kernel
+ */
+int bignum_limb_mul(bignum_limb *res, const bignum_limb *a, const bignum_limb *b)
+{
+    if (a->size < b->size) {
+        swap(a, b);
+    }
+    if (a->size <= BN_FIXED_USE && a->size - b->size <= 1) {
+        u64 pad[BN_FIXED_MAX];
+        const u64 *bl = b->limb;
+        if (bignum_limb_reserve(res, 2 * a->size)) {
+            return -ENOMEM;
+        }
+        if (b->size < a->size) {
+            memcpy(pad, b->limb, sizeof(u64) * b->size);
+            pad[b->size] = 0;
+            bl = pad;
+        }
+        bn_mul_fixed(res->limb, a->limb, bl, a->size);
+        res->size = 2 * a->size;
+        bignum_limb_normalize(res);
+        return 0;
+    }
+
+    int n = a->size + b->size;
+    if (bignum_limb_reserve(res, n)) {
+        return -ENOMEM;
+    }
+    memset(res->limb, 0, sizeof(u64) * n);
+
+    for (int i = 0; i < a->size; ++i) {
+        if ((i & 1023) == 1023 && fib_should_stop()) {
+            return -EINTR;
+        }
+
+        u64 carry = 0;
+        for (int j = 0; j < b->size; ++j) {
+            unsigned __int128 t = (unsigned __int128) a->limb[i] * b->limb[j] +
+                                  res->limb[i + j] + carry;
+            res->limb[i + j] = (u64) t;
+            carry = (u64) (t >> 64);
+        }
+        res->limb[i + b->size] = carry;
+    }
+    res->size = n;
+    bignum_limb_normalize(res);
+
+    return 0;
+}
+
+/*
+ * @r[0 .. 2n) = @a[0 .. n)^2, @r must not overlap @a
+ * every cross product a[i] * a[j] appears twice in the square, so it is
+ * calculated once and doubled, which saves nearly half of the multiplications
+ * up to BN_FIXED_USE limbs the fixed width kernel does it
+ * return: 0, or -EINTR if the caller was killed meanwhile
+ */
+static int bn_sqr_raw(u64 *r, const u64 *a, int n)
+{
+    if (n <= BN_FIXED_USE && bn_sqr_fixed(r, a, n)) {
+        return 0;
+    }
+
+    memset(r, 0, sizeof(u64) * 2 * n);
+
+    /* the cross products below the diagonal */
+    for (int i = 0; i < n - 1; ++i) {
+        if ((i & 1023) == 1023 && fib_should_stop()) {
+            return -EINTR;
+        }
+
+        u64 carry = 0;
+        for (int j = i + 1; j < n; ++j) {
+            unsigned __int128 t = (unsigned __int128) a[i] * a[j] + r[i + j] + carry;
+            r[i + j] = (u64) t;
+            carry = (u64) (t >> 64);
+        }
+        r[i + n] = carry;
+    }
+
+    /* doubled, plus the squares on the diagonal */
+    u64 shifted = 0, carry = 0;
+    for (int i = 0; i < n; ++i) {
+        unsigned __int128 sq = (unsigned __int128) a[i] * a[i];
+        u64 lo = r[2 * i], hi = r[2 * i + 1];
+
+        unsigned __int128 t = (unsigned __int128) ((lo << 1) | shifted) + (u64) sq + carry;
+        r[2 * i] = (u64) t;
+        shifted = lo >> 63;
+
+        t = (unsigned __int128) ((hi << 1) | shifted) + (u64) (sq >> 64) + (u64) (t >> 64);
+        r[2 * i + 1] = (u64) t;
+        shifted = hi >> 63;
+        carry = (u64) (t >> 64);
+    }
+
+    return 0;
+}
+
+/* @res = @a^2 */
+int bignum_limb_sqr(bignum_limb *res, const bignum_limb *a)
+{
+    int n = a->size;
+    if (bignum_limb_reserve(res, 2 * n)) {
+        return -ENOMEM;
+    }
+    if (bn_sqr_raw(res->limb, a->limb, n)) {
+        return -EINTR;
+    }
+    res->size = 2 * n;
+    bignum_limb_normalize(res);
+
+    return 0;
+}
+
+/* @num += @value */
+static int bignum_limb_add_small(bignum_limb *num, u64 value)
+{
+    if (bignum_limb_reserve(num, num->size + 1)) {
+        return -ENOMEM;
+    }
+
+    u64 carry = bn_add_1(num->limb, num->limb, num->size, value);
+    if (carry) {
+        num->limb[num->size++] = carry;
+    }
+
+    return 0;
+}
+
+/* @num -= @value, where @num >= @value */
+static void bignum_limb_sub_small(bignum_limb *num, u64 value)
+{
+    bn_sub_1(num->limb, num->limb, num->size, value);
+    bignum_limb_normalize(num);
+}
+
+/* @num >>= 1 */
+static void bignum_limb_shr1(bignum_limb *num)
+{
+    for (int i = 0; i < num->size - 1; ++i) {
+        num->limb[i] = (num->limb[i] >> 1) | (num->limb[i + 1] << 63);
+    }
+    num->limb[num->size - 1] >>= 1;
+    bignum_limb_normalize(num);
+}
+
+/*
+ * base 10^18 limbs
+ *
+ * A bignum_limb may also hold its value in limbs of 18 decimal digits,
+ * least significant first. They add up as linearly as the binary ones and
+ * print in a single pass, so a number that is only ever added to, like the
+ * sequence of the generator, becomes decimal without a conversion.
+ */
+#define DEC_LIMB_BASE 1000000000000000000ULL
+#define DEC_LIMB_DIGITS 18
+
+/*
+ * function that converts a bignum_limb into base 10^18 limbs
+ * the limbs are cut into 32-bit halves and divided by 10^9 repeatedly,
+ * each division giving away the next nine digits
+ */
+static int bignum_limb_to_dec(bignum_limb *dec, const bignum_limb *num)
+{
+    /* a limb holds less than 20 decimal digits */
+    if (bignum_limb_reserve(dec, num->size * 20 / DEC_LIMB_DIGITS + 2)) {
+        return -ENOMEM;
+    }
+    u32 *half = (u32 *)fib_alloc(sizeof(u32) * num->size * 2);
+    if (!half) {
+        return -ENOMEM;
+    }
+
+    int top = 0;
+    for (int i = 0; i < num->size; ++i) {
+        half[top++] = (u32) num->limb[i];
+        half[top++] = (u32) (num->limb[i] >> 32);
+    }
+    while (top > 0 && half[top - 1] == 0) {
+        top--;
+    }
+
+    /* the chunks of nine digits come out least significant first */
+    int chunks = 0;
+    dec->limb[0] = 0;
+    while (top > 0) {
+        if ((chunks & 127) == 0 && fib_should_stop()) {
+            fib_free(half);
+            return -EINTR;
+        }
+
+        u64 rem = 0;
+        for (int i = top - 1; i >= 0; --i) {
+            u64 cur = (rem << 32) | half[i];
+            rem = do_div(cur, 1000000000);
+            half[i] = (u32) cur;
+        }
+        while (top > 0 && half[top - 1] == 0) {
+            top--;
+        }
+
+        if (chunks & 1) {
+            dec->limb[chunks >> 1] += rem * 1000000000ULL;
+        }
+        else {
+            dec->limb[chunks >> 1] = rem;
+        }
+        chunks++;
+    }
+    fib_free(half);
+    dec->size = chunks ? (chunks + 1) >> 1 : 1;
+
+    return 0;
+}
+
+/* @res = @a + @b in base 10^18, @res may be one of the sources */
+static int bignum_dec_add(bignum_limb *res, const bignum_limb *a, const bignum_limb *b)
+{
+    if (a->size < b->size) {
+        swap(a, b);
+    }
+    int n = a->size, m = b->size;
+    if (bignum_limb_reserve(res, n + 1)) {
+        return -ENOMEM;
+    }
+
+    u64 carry = 0;
+    int i = 0;
+    for (; i < m; ++i) {
+        u64 sum = a->limb[i] + b->limb[i] + carry;
+        carry = sum >= DEC_LIMB_BASE;
+        res->limb[i] = carry ? sum - DEC_LIMB_BASE : sum;
+    }
+    for (; i < n; ++i) {
+        u64 sum = a->limb[i] + carry;
+        carry = sum >= DEC_LIMB_BASE;
+        res->limb[i] = carry ? sum - DEC_LIMB_BASE : sum;
+    }
+    res->limb[n] = carry;
+    res->size = n + carry;
+
+    return 0;
+}
+
+/* the nine digits of @chunk, zero padded */
+static inline void dec_put9(char *out, u32 chunk)
+{
+    for (int i = 8; i >= 0; --i) {
+        out[i] = '0' + chunk % 10;
+        chunk /= 10;
+    }
+}
+
+/*
+ * function that writes base 10^18 limbs as a decimal string
+ * most significant digit first, without leading zeros
+ * @out: the destination, at least num->size * 18 + 1 bytes
+ * return: the length of the string, excluding the null terminator
+ */
+static int bignum_dec_print(const bignum_limb *num, char *out)
+{
+    int len = sprintf(out, "%llu", (unsigned long long) num->limb[num->size - 1]);
+
+    for (int i = num->size - 2; i >= 0; --i) {
+        u64 hi = num->limb[i];
+        u32 lo = do_div(hi, 1000000000);
+        dec_put9(out + len, (u32) hi);
+        dec_put9(out + len + 9, lo);
+        len += DEC_LIMB_DIGITS;
+    }
+    out[len] = '\0';
+
+    return len;
+}
+
+/* function that writes a bignum_limb as a null terminated decimal string */
+char *bignum_limb_to_decimal(const bignum_limb *num)
+{
+    bignum_limb *dec = bignum_limb_new(1);
+    char *decimal = NULL;
+
+    if (dec && bignum_limb_to_dec(dec, num) == 0) {
+        decimal = (char *)fib_alloc(dec->size * DEC_LIMB_DIGITS + 1);
+        if (decimal) {
+            bignum_dec_print(dec, decimal);
+        }
+    }
+    bignum_limb_free(dec);
+
+    return decimal;
+}
+
+/*
+ * fused fast doubling
+ *
+ * The step works on (F(k), F(k - 1)) and costs two squarings per bit,
+ * where F(2k) = F(k) * (2 * F(k + 1) - F(k)) and F(2k + 1) = F(k)^2 +
+ * F(k + 1)^2 cost a multiplication and two squarings. With A = F(k)^2,
+ * B = F(k - 1)^2 and s = (-1)^k
+ *
+ * F(2k - 1) = A + B
+ * F(2k)     = 3A - 2B + 2s
+ * F(2k + 1) = 4A - B + 2s
+ *
+ * All of them are linear in A and B, so the two that are kept are written
+ * in a single pass over A and B, the shifts and the subtraction folded into
+ * a signed carry. Nothing is allocated in the loop: F(k), F(k - 1) and the
+ * two squares live in four buffers provided by the caller, each large
+ * enough for the last step.
+ */
+
+/* limbs each buffer of bn_fib_fused() needs for index @k */
+static int bn_fib_limbs(long long k)
+{
+    /* F(k + 1) has less than 0.6943 * (k + 1) + 1 bits */
+    return (mult_frac((unsigned long) k, 694242, 1000000) + 3) / 64 + 4;
+}
+
+/*
+ * the single pass of the step
+ * @a, @b: A and B, @n limbs each
+ * @bit: the next bit of the index, @odd: k is odd, i.e. s = -1
+ * writes @n + 1 limbs of F(2k + 1) into @x and F(2k) into @y if @bit is set,
+ * otherwise F(2k) into @x and F(2k - 1) into @y
+ */
+static void bn_fib_combine(u64 *x, u64 *y, const u64 *a, const u64 *b, int n, bool bit,
+                           bool odd)
+{
+    int xa = bit ? 4 : 3, xb = bit ? -1 : -2;
+    int ya = bit ? 3 : 1, yb = bit ? -2 : 1;
+    __int128 cx = odd ? -2 : 2;
+    __int128 cy = bit ? cx : 0;
+
+    for (int i = 0; i < n; ++i) {
+        __int128 tx = (__int128) xa * a[i] + (__int128) xb * b[i] + cx;
+        __int128 ty = (__int128) ya * a[i] + (__int128) yb * b[i] + cy;
+        x[i] = (u64) tx;
+        y[i] = (u64) ty;
+        cx = tx >> 64;
+        cy = ty >> 64;
+    }
+    x[n] = (u64) cx;
+    y[n] = (u64) cy;
+}
+
+static inline int bn_normalized(const u64 *a, int n)
+{
+    while (n > 1 && a[n - 1] == 0) {
+        n--;
+    }
+    return n;
+}
+
+/*
+ * function that calculates F(k) into @f and F(k - 1) into @g
+ * @f, @g, @sa, @sb: bn_fib_limbs(k) limbs each, @sa and @sb are scratch
+ * @fn, @gn: set to the limbs in use of @f and @g
+ * return: 0, or -EINTR if the caller was killed meanwhile
+ */
+static int bn_fib_fused(long long k, u64 *f, int *fn, u64 *g, int *gn, u64 *sa, u64 *sb,
+                        struct fib_progress *progress)
+{
+    /* (F(1), F(0)), the most significant bit is consumed already */
+    f[0] = k ? 1 : 0;
+    g[0] = k ? 0 : 1;
+    *fn = *gn = 1;
+    if (k == 0) {
+        return 0;
+    }
+
+    bool odd = true;
+    for (u64 mask = (1ULL << (63 - __builtin_clzll(k))) >> 1; mask; mask >>= 1) {
+        if (fib_progress(progress, fls64(k) - fls64(mask))) {
+            return -EINTR;
+        }
+
+        int n = 2 * *fn;
+        if (bn_sqr_raw(sa, f, *fn) || bn_sqr_raw(sb, g, *gn)) {
+            return -EINTR;
+        }
+        memset(sb + 2 * *gn, 0, sizeof(u64) * (n - 2 * *gn));
+
+        bool bit = k & mask;
+        bn_fib_combine(f, g, sa, sb, n, bit, odd);
+        *fn = bn_normalized(f, n + 1);
+        *gn = bn_normalized(g, n + 1);
+        odd = bit;
+    }
+
+    return 0;
+}
+
+/* function that calculates F(k) into @fk and F(k + 1) into @fk1 */
+static int bignum_limb_fib_pair(long long k, bignum_limb *fk, bignum_limb *fk1,
+                                struct fib_progress *progress)
+{
+    int cap = bn_fib_limbs(k);
+    u64 *buf = (u64 *)fib_alloc(sizeof(u64) * cap * 4);
+    if (!buf) {
+        return -ENOMEM;
+    }
+
+    u64 *f = buf, *g = buf + cap;
+    int fn, gn;
+    int err = bn_fib_fused(k, f, &fn, g, &gn, buf + 2 * cap, buf + 3 * cap, progress);
+    if (!err && (bignum_limb_reserve(fk, fn) || bignum_limb_reserve(fk1, fn + 1))) {
+        err = -ENOMEM;
+    }
+
+    if (!err) {
+        memcpy(fk->limb, f, sizeof(u64) * fn);
+        fk->size = fn;
+
+        /* F(k + 1) = F(k) + F(k - 1), where F(k - 1) <= F(k) */
+        u64 carry = bn_add_n(fk1->limb, f, g, gn);
+        carry = bn_add_1(fk1->limb + gn, f + gn, fn - gn, carry);
+        fk1->limb[fn] = carry;
+        fk1->size = fn + carry;
+    }
+    fib_free(buf);
+
+    return err;
+}
+
+/*
+ * the last (n, F(n), F(n + 1)) of an open file
+ *
+ * Clients tend to walk the indices in order, so a request for k near the
+ * previous one starts from there: a few steps away it advances (or backs
+ * up) by additions, and up to n/2 ahead it jumps with
+ *
+ * F(n + d) = F(n + 1) * F(d) + F(n) * F(d - 1)
+ * F(n + d + 1) = F(n + 1) * F(d + 1) + F(n) * F(d)
+ *
+ * which only needs F(d) and F(d + 1) of the small distance d. Anything else
+ * is calculated from scratch.
+ *
+ * A request takes the memo out of the file with xchg() and puts the new one
+ * back the same way, so requests sharing a file never wait on each other;
+ * one that finds the memo taken just starts from F(0).
+ */
+struct fib_memo {
+    long long n;
+    bignum_limb *fn;    /* F(n) */
+    bignum_limb *fn1;   /* F(n + 1) */
+};
+
+/* the farthest distance covered by additions */
+#define FIB_MEMO_STEPS 64
+
+static bool memo = true;
+module_param(memo, bool, 0644);
+MODULE_PARM_DESC(memo, "let mode 8 start from the previous result of the file");
+
+static struct {
+    atomic64_t hits;    /* the same index again */
+    atomic64_t steps;   /* reached by additions */
+    atomic64_t jumps;   /* reached by the addition formula */
+    atomic64_t misses;  /* calculated from scratch */
+} fib_memo_stat;
+
+static void fib_memo_free(struct fib_memo *m)
+{
+    if (!m) {
+        return;
+    }
+    bignum_limb_free(m->fn);
+    bignum_limb_free(m->fn1);
+    fib_free(m);
+}
+
+/* a memo holding (0, F(0), F(1)) */
+static struct fib_memo *fib_memo_new(void)
+{
+    struct fib_memo *m = (struct fib_memo *)fib_alloc(sizeof(struct fib_memo));
+    if (!m) {
+        return NULL;
+    }
+    m->n = 0;
+    m->fn = bignum_limb_new(1);
+    m->fn1 = bignum_limb_new(1);
+    if (!m->fn || !m->fn1) {
+        fib_memo_free(m);
+        return NULL;
+    }
+    bignum_limb_set(m->fn1, 1);
+
+    return m;
+}
+
+/* move @m @d steps forward (@d > 0) or backward (@d < 0) */
+static int fib_memo_step(struct fib_memo *m, long long d)
+{
+    for (; d > 0; --d) {
+        /* (F(n), F(n + 1)) -> (F(n + 1), F(n + 2)) */
+        if (bignum_limb_add(m->fn, m->fn, m->fn1)) {
+            return -ENOMEM;
+        }
+        swap(m->fn, m->fn1);
+        m->n++;
+    }
+    for (; d < 0; ++d) {
+        /* (F(n), F(n + 1)) -> (F(n - 1), F(n)) */
+        if (bignum_limb_sub(m->fn1, m->fn1, m->fn)) {
+            return -ENOMEM;
+        }
+        swap(m->fn, m->fn1);
+        m->n--;
+    }
+
+    return 0;
+}
+
+/* move @m @d steps forward with the addition formula */
+static int fib_memo_jump(struct fib_memo *m, long long d, struct fib_progress *progress)
+{
+    bignum_limb *fd = bignum_limb_new(1), *fd1 = bignum_limb_new(1);
+    bignum_limb *t1 = bignum_limb_new(1), *t2 = bignum_limb_new(1), *t3 = bignum_limb_new(1);
+    int err = -ENOMEM;
+    if (!fd || !fd1 || !t1 || !t2 || !t3) {
+        goto out;
+    }
+
+    if ((err = bignum_limb_fib_pair(d, fd, fd1, progress)) ||
+        (err = bignum_limb_mul(t1, m->fn1, fd)) ||
+        (err = bignum_limb_mul(t2, m->fn1, fd1)) ||
+        (err = bignum_limb_sub(fd1, fd1, fd)) ||   /* F(d - 1) */
+        (err = bignum_limb_mul(t3, m->fn, fd1)) ||
+        (err = bignum_limb_add(t1, t1, t3)) ||     /* F(n + d) */
+        (err = bignum_limb_mul(t3, m->fn, fd)) ||
+        (err = bignum_limb_add(t2, t2, t3))) {     /* F(n + d + 1) */
+        goto out;
+    }
+    swap(*m->fn, *t1);
+    swap(*m->fn1, *t2);
+    m->n += d;
+
+out:
+    bignum_limb_free(fd);
+    bignum_limb_free(fd1);
+    bignum_limb_free(t1);
+    bignum_limb_free(t2);
+    bignum_limb_free(t3);
+    return err;
+}
+
+/*
+ * function that calculates F(k) in limbs, starting from the memo in @slot
+ * when it is close enough, and leaves (k, F(k), F(k + 1)) there afterwards
+ * return: F(k), or NULL if out of memory or killed
+ */
+bignum_limb *bignum_limb_fibonacci(struct fib_memo **slot, long long k,
+                                   struct fib_progress *progress)
+{
+    bool use_memo = READ_ONCE(memo);
+    struct fib_memo *m = use_memo ? xchg(slot, NULL) : NULL;
+    if (!m) {
+        m = fib_memo_new();
+        if (!m) {
+            return NULL;
+        }
+    }
+
+    long long d = k - m->n;
+    int err;
+    if (!use_memo) {
+        err = bignum_limb_fib_pair(k, m->fn, m->fn1, progress);
+    }
+    else if (d == 0) {
+        atomic64_inc(&fib_memo_stat.hits);
+        err = 0;
+    }
+    else if (d >= -FIB_MEMO_STEPS && d <= FIB_MEMO_STEPS) {
+        atomic64_inc(&fib_memo_stat.steps);
+        err = fib_memo_step(m, d);
+    }
+    else if (d > 0 && d <= m->n / 2) {
+        atomic64_inc(&fib_memo_stat.jumps);
+        err = fib_memo_jump(m, d, progress);
+    }
+    else {
+        atomic64_inc(&fib_memo_stat.misses);
+        err = bignum_limb_fib_pair(k, m->fn, m->fn1, progress);
+    }
+    m->n = k;
+
+    bignum_limb *res = err ? NULL : bignum_limb_new(1);
+    if (!res || bignum_limb_copy(res, m->fn)) {
+        bignum_limb_free(res);
+        fib_memo_free(m);
+        return NULL;
+    }
+
+    if (use_memo) {
+        fib_memo_free(xchg(slot, m));
+    }
+    else {
+        fib_memo_free(m);
+    }
+
+    return res;
+}
+
+/*
+ * function that calculates F(k) by powers of the fibonacci matrix
+ *
+ * Q^n = | F(n + 1)  F(n)     |
+ *       | F(n)      F(n - 1) |
+ *
+ * The bits of @k are scanned from the most significant one, squaring the
+ * matrix for every bit and multiplying it by Q for every set bit. Powers of
+ * Q are symmetric, so with (a, b, c) for the entries, squaring is
+ *
+ * | a  b |^2 = | a^2 + b^2    b * (a + c) |
+ * | b  c |     | b * (a + c)  b^2 + c^2   |
+ *
+ * three squarings and one multiplication instead of eight products, and
+ * multiplying by Q is (a, b, c) -> (a + b, a, b), additions only.
+ */
+bignum_limb *bignum_limb_matrix(long long k, struct fib_progress *progress)
+{
+    bignum_limb *a = bignum_limb_new(1), *b = bignum_limb_new(1), *c = bignum_limb_new(1);
+    bignum_limb *a2 = bignum_limb_new(1), *b2 = bignum_limb_new(1), *c2 = bignum_limb_new(1);
+    bignum_limb *res = NULL;
+    if (!a || !b || !c || !a2 || !b2 || !c2) {
+        goto out;
+    }
+
+    /* Q^0, the identity */
+    bignum_limb_set(a, 1);
+    bignum_limb_set(c, 1);
+
+    for (u64 mask = k ? 1ULL << (63 - __builtin_clzll(k)) : 0; mask; mask >>= 1) {
+        if (fib_progress(progress, fls64(k) - fls64(mask) + 1)) {
+            goto out;
+        }
+
+        /* a2 = a^2 + b^2, b2 = b * (a + c), c2 = b^2 + c^2 */
+        if (bignum_limb_sqr(a2, a) || bignum_limb_sqr(c2, c) ||
+            bignum_limb_add(a, a, c) || bignum_limb_sqr(c, b) ||
+            bignum_limb_mul(b2, b, a) ||
+            bignum_limb_add(a2, a2, c) || bignum_limb_add(c2, c2, c)) {
+            goto out;
+        }
+        swap(a, a2);
+        swap(b, b2);
+        swap(c, c2);
+
+        if (k & mask) {
+            /* (a, b, c) -> (a + b, a, b) */
+            if (bignum_limb_add(c2, a, b)) {
+                goto out;
+            }
+            swap(c, b);
+            swap(b, a);
+            swap(a, c2);
+        }
+    }
+
+    res = b;
+    b = NULL;
+
+out:
+    bignum_limb_free(a);
+    bignum_limb_free(b);
+    bignum_limb_free(c);
+    bignum_limb_free(a2);
+    bignum_limb_free(b2);
+    bignum_limb_free(c2);
+    return res;
+}
+
+/*
+ * function that calculates F(k) along with the lucas numbers L(k)
+ *
+ * F(2n) = F(n) * L(n)
+ * L(2n) = L(n)^2 - 2 * (-1)^n
+ * F(2n + 1) = (F(2n) + L(2n)) / 2
+ * L(2n + 1) = (5 * F(2n) + L(2n)) / 2
+ *
+ * Each bit of @k costs a squaring and a multiplication, the odd step is
+ * additions and a shift. On the last bit L is no longer needed, so an even
+ * @k skips its squaring.
+ */
+bignum_limb *bignum_limb_lucas(long long k, struct fib_progress *progress)
+{
+    /* f = F(n), l = L(n), starting from n = 0 */
+    bignum_limb *f = bignum_limb_new(1), *l = bignum_limb_new(1);
+    bignum_limb *t1 = bignum_limb_new(1), *t2 = bignum_limb_new(1);
+    bignum_limb *res = NULL;
+    if (!f || !l || !t1 || !t2) {
+        goto out;
+    }
+    bignum_limb_set(l, 2);
+    bool odd = false;   /* n is odd */
+
+    for (u64 mask = k ? 1ULL << (63 - __builtin_clzll(k)) : 0; mask; mask >>= 1) {
+        if (fib_progress(progress, fls64(k) - fls64(mask) + 1)) {
+            goto out;
+        }
+
+        /* t1 = F(2n) */
+        if (bignum_limb_mul(t1, f, l)) {
+            goto out;
+        }
+        swap(f, t1);
+        if (mask == 1 && !(k & mask)) {
+            break;
+        }
+
+        /* t1 = L(2n) */
+        if (bignum_limb_sqr(t1, l)) {
+            goto out;
+        }
+        if (odd) {
+            if (bignum_limb_add_small(t1, 2)) {
+                goto out;
+            }
+        }
+        else {
+            bignum_limb_sub_small(t1, 2);
+        }
+        swap(l, t1);
+        odd = false;
+
+        if (k & mask) {
+            /* t1 = 5 * F(2n), then the halves of the sums */
+            if (bignum_limb_add(t1, f, f) || bignum_limb_add(t1, t1, t1) ||
+                bignum_limb_add(t1, t1, f) || bignum_limb_add(t1, t1, l) ||
+                bignum_limb_add(t2, f, l)) {
+                goto out;
+            }
+            bignum_limb_shr1(t1);
+            bignum_limb_shr1(t2);
+            swap(f, t2);
+            swap(l, t1);
+            odd = true;
+        }
+    }
+
+    res = f;
+    f = NULL;
+
+out:
+    bignum_limb_free(f);
+    bignum_limb_free(l);
+    bignum_limb_free(t1);
+    bignum_limb_free(t2);
+    return res;
+}
+
+
+static long long fib_sequence(long long k)
+{
+    /* if F0 or F1, then return F0 or F1 */
+    if (k < 2) {
+        return k;
+    }
+
+    /* F0 = 0 = n1
+     * F1 = 1 = n2
+     * F2 = 1 = n3
+     */
+    long long n1 = 0, n2 = 1, n3 = 1;
+    
+    for (long long i = 2; i <= k; ++i) {
+        /* only an absurd max_index gets here, F(93) already overflows */
+        if ((i & 0xfffff) == 0 && fib_should_stop()) {
+            break;
+        }
+        n3 = n1 + n2;
+        n1 = n2;
+        n2 = n3;
+    }
+
+    return n2;
+}
+
+/* function that calculates fibonacci number using fast doubling
+ */
+static unsigned long long fast_doubling(long long n)
+{
+    long long a = 0, b = 1;
+
+    for (unsigned int i = 1U << 31; i; i >>= 1)
+    {
+        long long t1 = a * (2 * b - a);
+        long long t2 = a * a + b * b;
+
+        if ((n & i) != 0)
+        {
+            a = t2;
+            b = t1 + t2;
+        } else
+        {
+            a = t1;
+            b = t2;
+        }
+    }
+    
+    return a;
+}
+
+/* function that calculates fibonacci number using fast doubling
+ * with clz for speeding up
+ */
+static long long fast_doubling_clz(long long n)
+{
+    long long a = 0, b = 1;
+
+    for (unsigned int i = (1U << (31 - __builtin_clz(n))); i; i >>= 1)
+    {
+        long long t1 = a * (2 * b - a);
+        long long t2 = a * a + b * b;
+
+        if ((n & i) != 0)
+        {
+            a = t2;
+            b = t1 + t2;
+        } else
+        {
+            a = t1;
+            b = t2;
+        }
+    }
+
+    return a;
+}
+
+/*
+ * F(n) mod m for any 64-bit n and m
+ *
+ * Fast doubling as in fast_doubling_clz, but on residues and over all 64 bits
+ * of n. The products need no 128-bit division: an odd m is handled with
+ * Montgomery multiplication (R = 2^64), and an even m = 2^s * q is split
+ * into F(n) mod 2^s, which is plain wrapping u64 arithmetic, and F(n) mod q,
+ * then both are joined by the chinese remainder theorem.
+ *
+ * F(n) mod m repeats with the Pisano period of m (at most 6m), so for
+ * m <= pisano_max the period is found once, cached, and n reduced by it.
+ */
+
+/* the largest modulus whose Pisano period gets calculated and cached */
+static unsigned int pisano_max = 1 << 16;
+module_param(pisano_max, uint, 0644);
+MODULE_PARM_DESC(pisano_max, "largest modulus of FIB_IOC_MOD to cache the Pisano period of, 0 disables");
+
+/* direct mapped by m, an entry packs m in the high and its period in the low half */
+#define FIB_PISANO_SLOTS 256
+static u64 fib_pisano[FIB_PISANO_SLOTS];
+
+struct fib_mont {
+    u64 m;      /* odd modulus */
+    u64 minv;   /* -m^-1 mod 2^64 */
+    u64 one;    /* R mod m, i.e. 1 in Montgomery form */
+};
+
+/* x^-1 mod 2^64 of an odd x, by Newton's iteration */
+static inline u64 fib_inv64(u64 x)
+{
+    u64 inv = x;    /* correct to 3 bits, each step doubles it */
+
+    for (int i = 0; i < 5; ++i) {
+        inv *= 2 - x * inv;
+    }
+    return inv;
+}
+
+static inline u64 fib_addmod(u64 a, u64 b, u64 m)
+{
+    return a >= m - b ? a - (m - b) : a + b;
+}
+
+static inline u64 fib_submod(u64 a, u64 b, u64 m)
+{
+    return a >= b ? a - b : a - b + m;
+}
+
+/* a * b / R mod m, for a, b < m */
+static inline u64 fib_mont_mul(const struct fib_mont *mt, u64 a, u64 b)
+{
+    unsigned __int128 t = (unsigned __int128) a * b;
+    u64 q = (u64) t * mt->minv;
+    unsigned __int128 qm = (unsigned __int128) q * mt->m;
+
+    /* the low halves cancel out, only their carry is left */
+    unsigned __int128 r = (t >> 64) + (qm >> 64) + ((u64) t != 0);
+
+    return r >= mt->m ? (u64) (r - mt->m) : (u64) r;
+}
+
+static void fib_mont_init(struct fib_mont *mt, u64 m)
+{
+    mt->m = m;
+    mt->minv = -fib_inv64(m);
+    mt->one = -m % m;   /* 2^64 - m = 2^64 mod m */
+}
+
+/* F(n) mod the odd @m > 1 */
+static u64 fib_mod_odd(u64 n, u64 m)
+{
+    struct fib_mont mt;
+    fib_mont_init(&mt, m);
+
+    /* a = F(k), b = F(k + 1), both in Montgomery form */
+    u64 a = 0, b = mt.one;
+    for (u64 mask = n ? 1ULL << (63 - __builtin_clzll(n)) : 0; mask; mask >>= 1) {
+        u64 t1 = fib_mont_mul(&mt, a, fib_submod(fib_addmod(b, b, m), a, m));
+        u64 t2 = fib_addmod(fib_mont_mul(&mt, a, a), fib_mont_mul(&mt, b, b), m);
+
+        if (n & mask) {
+            a = t2;
+            b = fib_addmod(t1, t2, m);
+        }
+        else {
+            a = t1;
+            b = t2;
+        }
+    }
+
+    /* leave the Montgomery form */
+    return fib_mont_mul(&mt, a, 1);
+}
+
+/* F(n) mod 2^64 */
+static u64 fib_mod_pow2(u64 n)
+{
+    u64 a = 0, b = 1;
+
+    for (u64 mask = n ? 1ULL << (63 - __builtin_clzll(n)) : 0; mask; mask >>= 1) {
+        u64 t1 = a * (2 * b - a);
+        u64 t2 = a * a + b * b;
+
+        if (n & mask) {
+            a = t2;
+            b = t1 + t2;
+        }
+        else {
+            a = t1;
+            b = t2;
+        }
+    }
+
+    return a;
+}
+
+/*
+ * function that finds the Pisano period of @m, i.e. the length of the cycle
+ * of F(n) mod m, by walking the sequence until (0, 1) comes back
+ * return: the period, or 0 if the caller was killed meanwhile
+ */
+static u64 fib_pisano_period(u32 m)
+{
+    u64 a = 0, b = 1;
+    u64 n = 0;
+
+    do {
+        u64 t = a + b >= m ? a + b - m : a + b;
+        a = b;
+        b = t;
+        n++;
+        if ((n & 0xffff) == 0 && fib_should_stop()) {
+            return 0;
+        }
+    } while (a != 0 || b != 1);
+
+    return n;
+}
+
+/* n reduced by the cached Pisano period of @m, if @m is small enough */
+static u64 fib_pisano_reduce(u64 n, u64 m)
+{
+    if (m > READ_ONCE(pisano_max) || m > U32_MAX) {
+        return n;
+    }
+
+    u64 *slot = &fib_pisano[m % FIB_PISANO_SLOTS];
+    u64 entry = READ_ONCE(*slot);
+    u64 period;
+
+    if (entry >> 32 == m) {
+        period = (u32) entry;
+    }
+    else {
+        period = fib_pisano_period(m);
+        /* the period of m is at most 6m, it fits in 32 bits for the m cached */
+        if (!period || period > U32_MAX) {
+            return n;
+        }
+        WRITE_ONCE(*slot, m << 32 | period);
+    }
+
+    return n % period;
+}
+
+/* function that calculates F(n) mod @m, @m > 0 */
+static u64 fib_mod(u64 n, u64 m)
+{
+    if (m == 1) {
+        return 0;
+    }
+
+    n = fib_pisano_reduce(n, m);
+
+    int s = __builtin_ctzll(m);
+    u64 q = m >> s;
+    if (s == 0) {
+        return fib_mod_odd(n, m);
+    }
+
+    u64 mask = (1ULL << s) - 1;
+    u64 r2 = fib_mod_pow2(n) & mask;
+    if (q == 1) {
+        return r2;
+    }
+
+    /* x = rq + q * ((r2 - rq) * q^-1 mod 2^s) is below q * 2^s = m */
+    u64 rq = fib_mod_odd(n, q);
+    u64 t = ((r2 - rq) * fib_inv64(q)) & mask;
+
+    return rq + q * t;
+}
+
+/*
+ * the rendered output of a bignum request
+ *
+ * Ownership: a result belongs to the fib_ctx of an open file and is reused by
+ * every request on it, its buffer only grows and is freed on release. With
+ * coalescing on, a result belongs to a struct fib_shared instead and is
+ * freed with its last reference.
+ * fib_bignum_output() fills it, freeing every bignum and intermediate string
+ * before it returns, so nothing outlives the request but this buffer.
+ */
+struct fib_result {
+    char *buf;
+    size_t len;     /* bytes of output in buf */
+    size_t cap;     /* bytes buf can hold */
+    bool shared;    /* part of a struct fib_shared */
+};
+
+/* make sure @res can hold @bytes, the old content is not preserved */
+static int fib_result_reserve(struct fib_result *res, size_t bytes)
+{
+    if (bytes <= res->cap) {
+        return 0;
+    }
+
+    char *buf = (char *)fib_realloc(res->buf, bytes);
+    if (!buf) {
+        return -ENOMEM;
+    }
+    res->buf = buf;
+    res->cap = bytes;
+
+    return 0;
+}
+
+/* copy @len bytes of @src into @res */
+static int fib_result_store(struct fib_result *res, const char *src, size_t len)
+{
+    if (fib_result_reserve(res, len)) {
+        return -ENOMEM;
+    }
+    memcpy(res->buf, src, len);
+    res->len = len;
+
+    return 0;
+}
+
+/* render @num into @res in format @fmt (hex or raw) */
+static int fib_result_store_limb(struct fib_result *res, const bignum_limb *num, int fmt)
+{
+    if (fmt == FIB_FMT_HEX) {
+        if (fib_result_reserve(res, num->size * 16 + 1)) {
+            return -ENOMEM;
+        }
+        res->len = bignum_limb_to_hex(num, res->buf) + 1;
+    }
+    else {
+        if (fib_result_reserve(res, num->size * sizeof(u64))) {
+            return -ENOMEM;
+        }
+        bignum_limb_to_raw(num, res->buf);
+        res->len = num->size * sizeof(u64);
+    }
+
+    return 0;
+}
+
+static void fib_result_free(struct fib_result *res)
+{
+    fib_free(res->buf);
+    res->buf = NULL;
+    res->len = res->cap = 0;
+}
+
+/*
+ * coalescing of concurrent requests
+ *
+ * The first request for an index, mode and format computes it into a
+ * result of its own, and announces it in fib_shared_table until it is
+ * done. Requests for the same triple meanwhile take a reference, wait for
+ * the completion and copy out the same buffer, which nobody writes once it
+ * is complete. The last reference frees it along with the memory budget of
+ * the computation. Such requests come from threads sharing the file
+ * descriptor, or from io_uring. The mode is part of the key so that a fast
+ * mode never waits behind a slow one.
+ *
+ * Off by default: every request then pays for the table and a result of
+ * its own instead of the buffer of the file, which only pays off when
+ * requests do collide.
+ */
+static bool coalesce = false;
+module_param(coalesce, bool, 0644);
+MODULE_PARM_DESC(coalesce, "let concurrent requests for the same index share one calculation");
+
+struct fib_shared {
+    struct hlist_node node;     /* in fib_shared_table while calculating */
+    long long k;
+    int mode;
+    int fmt;
+    refcount_t ref;
+    struct completion done;
+    int err;                    /* of the calculation, once done */
+    unsigned long budget;       /* released with the last reference */
+    struct fib_result result;
+};
+
+#define FIB_SHARED_BITS 6
+static DEFINE_HASHTABLE(fib_shared_table, FIB_SHARED_BITS);
+static DEFINE_SPINLOCK(fib_shared_lock);
+
+static struct {
+    atomic64_t computed;    /* calculated, for others too */
+    atomic64_t joined;      /* answered by another request */
+} fib_shared_stat;
+
+/*
+ * the calculation of F(@k) by mode @mode in @fmt in flight, with
+ * fib_shared_lock held
+ */
+static struct fib_shared *fib_shared_find(long long k, int mode, int fmt)
+{
+    struct fib_shared *sh;
+
+    hash_for_each_possible(fib_shared_table, sh, node, k) {
+        if (sh->k == k && sh->mode == mode && sh->fmt == fmt) {
+            return sh;
+        }
+    }
+    return NULL;
+}
+
+static void fib_shared_put(struct fib_shared *sh)
+{
+    if (refcount_dec_and_test(&sh->ref)) {
+        fib_result_free(&sh->result);
+        fib_mem_release(sh->budget);
+        kfree(sh);
+    }
+}
+
+/*
+ * generator of an open file, see FIB_IOC_SET_GENERATOR
+ *
+ * Keeps (F(k), F(k + 1)) of the next number to hand out, so streaming the
+ * sequence costs one addition per number. A read at another index (after
+ * lseek or with pread) starts over from bignum_limb_fib_pair().
+ */
+struct fib_gen {
+    struct mutex lock;
+    long long k;        /* the index of the binary pair, -1 if broken */
+    bignum_limb *a;     /* F(k) */
+    bignum_limb *b;     /* F(k + 1) */
+    long long dec_k;    /* the index of the decimal pair, -1 if broken */
+    bignum_limb *dec_a; /* F(dec_k) in base 10^18 */
+    bignum_limb *dec_b; /* F(dec_k + 1) in base 10^18 */
+    char *text;         /* F(text_k) rendered in text_fmt */
+    size_t text_len;
+    size_t text_cap;
+    long long text_k;
+    int text_fmt;
+};
+
+static void fib_gen_free(struct fib_gen *gen)
+{
+    if (!gen) {
+        return;
+    }
+    bignum_limb_free(gen->a);
+    bignum_limb_free(gen->b);
+    bignum_limb_free(gen->dec_a);
+    bignum_limb_free(gen->dec_b);
+    fib_free(gen->text);
+    mutex_destroy(&gen->lock);
+    kfree(gen);
+}
+
+/* a generator standing at F(0) */
+static struct fib_gen *fib_gen_new(void)
+{
+    struct fib_gen *gen = kzalloc(sizeof(struct fib_gen), GFP_KERNEL);
+    if (!gen) {
+        return NULL;
+    }
+    mutex_init(&gen->lock);
+    gen->a = bignum_limb_new(1);
+    gen->b = bignum_limb_new(1);
+    gen->dec_a = bignum_limb_new(1);
+    gen->dec_b = bignum_limb_new(1);
+    if (!gen->a || !gen->b || !gen->dec_a || !gen->dec_b) {
+        fib_gen_free(gen);
+        return NULL;
+    }
+    bignum_limb_set(gen->b, 1);
+    bignum_limb_set(gen->dec_b, 1);
+    gen->text_k = -1;
+
+    return gen;
+}
+
+/* per open file context, kept in file->private_data */
+struct fib_ctx {
+    int format;                 /* default output format of the bignum modes */
+    int mode;                   /* algorithm used by read_iter */
+    struct mutex lock;          /* held by the request using result */
+    struct fib_result result;   /* output buffer reused across requests */
+    struct fib_memo *memo;      /* last pair of mode 8, see struct fib_memo */
+    struct fib_gen *gen;        /* set up by the first FIB_IOC_SET_GENERATOR */
+    bool generator;             /* read streams the sequence, see fib_gen_read() */
+};
+
+/*
+ * function that picks the result buffer of a request
+ * it is the one of the open file if no other request holds it, otherwise
+ * @spare is handed out, so threads sharing a file descriptor never wait for
+ * each other
+ */
+static struct fib_result *fib_result_get(struct fib_ctx *ctx, struct fib_result *spare)
+{
+    if (mutex_trylock(&ctx->lock)) {
+        return &ctx->result;
+    }
+
+    memset(spare, 0, sizeof(struct fib_result));
+    return spare;
+}
+
+/*
+ * function that gives back a result buffer picked by fib_result_get(),
+ * or handed out by fib_request_shared()
+ */
+static void fib_result_put(struct fib_ctx *ctx, struct fib_result *res)
+{
+    if (res->shared) {
+        fib_shared_put(container_of(res, struct fib_shared, result));
+    }
+    else if (res == &ctx->result) {
+        mutex_unlock(&ctx->lock);
+    }
+    else {
+        fib_result_free(res);
+    }
+}
+
+static int fib_open(struct inode *inode, struct file *file)
+{
+    if (!mutex_trylock(&fib_mutex)) {
+        printk(KERN_ALERT "fibdrv is in use\n");
+        return -EBUSY;
+    }
+
+    struct fib_ctx *ctx = kzalloc(sizeof(struct fib_ctx), GFP_KERNEL);
+    if (!ctx) {
+        mutex_unlock(&fib_mutex);
+        return -ENOMEM;
+    }
+    ctx->format = FIB_FMT_DEC;
+    ctx->mode = FIB_MODE_BIN_FAST_DOUBLING_CLZ;
+    mutex_init(&ctx->lock);
+    file->private_data = ctx;
+
+    return 0;
+}
+
+static int fib_release(struct inode *inode, struct file *file)
+{
+    struct fib_ctx *ctx = file->private_data;
+
+    fib_result_free(&ctx->result);
+    fib_memo_free(ctx->memo);
+    fib_gen_free(ctx->gen);
+    mutex_destroy(&ctx->lock);
+    kfree(ctx);
+    mutex_unlock(&fib_mutex);
+    return 0;
+}
+
+/*
+ * function that returns the output format of a request
+ * the format encoded in @size overrides the one of the open file
+ */
+static int fib_request_format(struct file *file, size_t size)
+{
+    struct fib_ctx *ctx = file->private_data;
+    int fmt = (size >> FIB_FMT_SHIFT) & FIB_FMT_MASK;
+
+    return fmt ? fmt - 1 : READ_ONCE(ctx->format);
+}
+
+/*
+ * function that calculates F(k) with bignum mode @mode (3 ~ 10)
+ * and renders it into @res in format @fmt, reporting its steps to @progress
+ * return: 0, -ENOMEM, or -EINTR if the caller was killed meanwhile
+ */
+static int fib_bignum_output(struct fib_ctx *ctx, long long k, int mode, int fmt,
+                             struct fib_result *res, struct fib_progress *progress)
+{
+    char *decimal = NULL;
+    bignum_limb *limb = NULL;
+    int err = -ENOMEM;
+
+    if (mode == 3) {
+        bignum_decimal *num = bignum_decimal_fibonacci(k, progress);
+        if (!num) {
+            return fib_abort_errno();
+        }
+
+        if (fmt == FIB_FMT_DEC) {
+            err = fib_result_store(res, reverse_bignum_decimal_string(num), num->len);
+        }
+        else {
+            limb = bignum_decimal_to_limb(num);
+        }
+        free_bignum_decimal(num);
+    }
+    else if (mode == 4 || mode == 5 || mode == 6) {
+        bignum_bin *num;
+        if (mode == 4) {
+            num = bignum_bin_fibonacci(k, progress);
+        }
+        else if (mode == 5) {
+            num = bignum_bin_fast_doubling(k, progress);
+        }
+        else {
+            num = bignum_bin_fast_doubling_clz(k, progress);
+        }
+        if (!num) {
+            return fib_abort_errno();
+        }
+
+        if (fmt == FIB_FMT_DEC) {
+            decimal = bignum_bin_to_decimal(num);
+        }
+        else {
+            limb = bignum_bin_to_limb(num);
+        }
+        bignum_bin_free(num);
+    }
+    else if (mode == 7) {
+        BIGNUM *num = bignum_fast_doubling_clz(k, progress);
+        if (!num) {
+            return fib_abort_errno();
+        }
+
+        if (fmt == FIB_FMT_DEC) {
+            decimal = bignum_to_decimal(num);
+        }
+        else {
+            limb = bignum_to_limb(num);
+        }
+        FREE_BIGNUM(num);
+    }
+    else if (mode == 8 || mode == 9 || mode == 10) {
+        bignum_limb *num;
+        if (mode == 8) {
+            num = bignum_limb_fibonacci(&ctx->memo, k, progress);
+        }
+        else if (mode == 9) {
+            num = bignum_limb_matrix(k, progress);
+        }
+        else {
+            num = bignum_limb_lucas(k, progress);
+        }
+        if (!num) {
+            return fib_abort_errno();
+        }
+
+        if (fmt == FIB_FMT_DEC) {
+            decimal = bignum_limb_to_decimal(num);
+            bignum_limb_free(num);
+        }
+        else {
+            limb = num;
+        }
+    }
+
+    if (decimal) {
+        err = fib_result_store(res, decimal, strlen(decimal) + 1);
+        fib_free(decimal);
+    }
+    else if (limb) {
+        err = fib_result_store_limb(res, limb, fmt);
+        bignum_limb_free(limb);
+    }
+    else if (err) {
+        /* the conversion was killed or ran out of memory */
+        err = fib_abort_errno();
+    }
+
+    return err;
+}
+
+/*
+ * precomputed store
+ *
+ * After a reload every index is cold again, and the big ones take seconds.
+ * With the "store" parameter set, init pulls in a file of precomputed F(k)
+ * (see fib_store.c and struct fib_store_hdr) through request_firmware(), and
+ * fib_request() answers those indices from it in any bignum mode, without
+ * computing or reserving anything. The decimal form is rendered the first
+ * time it is asked for and kept with the entry.
+ */
+static char *store;
+module_param(store, charp, 0444);
+MODULE_PARM_DESC(store, "firmware file of precomputed results to load at init");
+
+struct fib_store_entry {
+    long long k;
+    bignum_limb num;    /* points into fib_store.data */
+    char *decimal;      /* null until the first decimal request */
+};
+
+struct fib_store {
+    unsigned int count;
+    size_t bytes;       /* size of the file */
+    s64 load_ns;        /* request_firmware() up to the published table */
+    u64 *data;          /* copy of the file, limbs in cpu order */
+    struct fib_store_entry entry[];
+};
+
+/* published once by fib_store_load(), gone at module exit */
+static struct fib_store *fib_store;
+static atomic64_t fib_store_lookups;
+
+static int fib_store_cmp(const void *a, const void *b)
+{
+    long long ka = ((const struct fib_store_entry *) a)->k;
+    long long kb = ((const struct fib_store_entry *) b)->k;
+
+    return ka < kb ? -1 : ka > kb;
+}
+
+static int fib_store_key_cmp(const void *key, const void *elt)
+{
+    long long k = *(const long long *) key;
+    long long ke = ((const struct fib_store_entry *) elt)->k;
+
+    return k < ke ? -1 : k > ke;
+}
+
+/* return: the entry of F(@k), or NULL when it is not in the store */
+static struct fib_store_entry *fib_store_find(long long k)
+{
+    struct fib_store *s = smp_load_acquire(&fib_store);
+
+    if (!s) {
+        return NULL;
+    }
+    return bsearch(&k, s->entry, s->count, sizeof(struct fib_store_entry),
+                   fib_store_key_cmp);
+}
+
+/* render the stored F(k) into @res in format @fmt */
+static int fib_store_output(struct fib_store_entry *e, int fmt, struct fib_result *res)
+{
+    if (fmt != FIB_FMT_DEC) {
+        return fib_result_store_limb(res, &e->num, fmt);
+    }
+
+    char *decimal = READ_ONCE(e->decimal);
+    if (!decimal) {
+        decimal = bignum_limb_to_decimal(&e->num);
+        if (!decimal) {
+            return fib_abort_errno();
+        }
+        /* racing readers render it too, the first one is kept */
+        char *old = cmpxchg(&e->decimal, NULL, decimal);
+        if (old) {
+            fib_free(decimal);
+            decimal = old;
+        }
+    }
+
+    return fib_result_store(res, decimal, strlen(decimal) + 1);
+}
+
+/*
+ * function that checks a store file and builds its lookup table
+ * return: the table, or an ERR_PTR() when the file is malformed
+ */
+static struct fib_store *fib_store_parse(const u8 *data, size_t size)
+{
+    const struct fib_store_hdr *hdr = (const struct fib_store_hdr *) data;
+
+    if (size < sizeof(*hdr) || le64_to_cpu(hdr->magic) != FIB_STORE_MAGIC ||
+        le32_to_cpu(hdr->version) != FIB_STORE_VERSION) {
+        return ERR_PTR(-EINVAL);
+    }
+
+    unsigned int count = le32_to_cpu(hdr->count);
+    struct fib_store *s = kvzalloc(struct_size(s, entry, count), GFP_KERNEL);
+    if (!s) {
+        return ERR_PTR(-ENOMEM);
+    }
+    /* a copy keeps the limbs aligned and lets the firmware go */
+    s->data = kvmalloc(size, GFP_KERNEL);
+    if (!s->data) {
+        kvfree(s);
+        return ERR_PTR(-ENOMEM);
+    }
+    memcpy(s->data, data, size);
+    s->bytes = size;
+    s->count = count;
+
+    size_t pos = sizeof(*hdr);
+    for (unsigned int i = 0; i < count; ++i) {
+        const struct fib_store_rec *rec = (const struct fib_store_rec *) (data + pos);
+        if (size - pos < sizeof(*rec)) {
+            goto bad;
+        }
+        pos += sizeof(*rec);
+
+        u32 limbs = le32_to_cpu(rec->limbs);
+        if (limbs == 0 || limbs > INT_MAX || (size - pos) / sizeof(u64) < limbs) {
+            goto bad;
+        }
+        size_t bytes = limbs * sizeof(u64);
+        if ((crc32_le(~0, data + pos, bytes) ^ ~0) != le32_to_cpu(rec->crc)) {
+            goto bad;
+        }
+
+        struct fib_store_entry *e = &s->entry[i];
+        e->k = le64_to_cpu(rec->k);
+        e->num.limb = s->data + pos / sizeof(u64);
+        e->num.size = limbs;
+        e->num.cap = limbs;
+        for (u32 j = 0; j < limbs; ++j) {
+            e->num.limb[j] = le64_to_cpu((__force __le64) e->num.limb[j]);
+        }
+        bignum_limb_normalize(&e->num);
+        pos += bytes;
+    }
+
+    sort(s->entry, count, sizeof(struct fib_store_entry), fib_store_cmp, NULL);
+    return s;
+
+bad:
+    kvfree(s->data);
+    kvfree(s);
+    return ERR_PTR(-EBADMSG);
+}
+
+static int fib_store_load(struct device *dev)
+{
+    const struct firmware *fw;
+    ktime_t start = ktime_get();
+
+    int err = request_firmware(&fw, store, dev);
+    if (err) {
+        return err;
+    }
+
+    struct fib_store *s = fib_store_parse(fw->data, fw->size);
+    release_firmware(fw);
+    if (IS_ERR(s)) {
+        return PTR_ERR(s);
+    }
+    s->load_ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+    printk(KERN_INFO "fibdrv: %u precomputed results from %s, %zu bytes in %lld us\n",
+           s->count, store, s->bytes, s->load_ns / 1000);
+    smp_store_release(&fib_store, s);
+
+    return 0;
+}
+
+static void fib_store_free(void)
+{
+    struct fib_store *s = fib_store;
+
+    if (!s) {
+        return;
+    }
+    for (unsigned int i = 0; i < s->count; ++i) {
+        fib_free(s->entry[i].decimal);
+    }
+    kvfree(s->data);
+    kvfree(s);
+    fib_store = NULL;
+}
+
+/*
+ * function that runs a bignum request, or joins the same one in flight
+ * the budget of @budget bytes belongs to the shared result, so the caller
+ * has nothing to release
+ * return: the shared result, or an ERR_PTR()
+ */
+static struct fib_result *fib_request_shared(struct fib_ctx *ctx, long long k, int mode,
+                                             int fmt, unsigned long budget)
+{
+    struct fib_shared *sh, *other;
+    int err;
+
+again:
+    spin_lock(&fib_shared_lock);
+    sh = fib_shared_find(k, mode, fmt);
+    if (sh) {
+        refcount_inc(&sh->ref);
+    }
+    spin_unlock(&fib_shared_lock);
+
+    if (!sh) {
+        sh = kzalloc(sizeof(struct fib_shared), GFP_KERNEL);
+        if (!sh) {
+            return ERR_PTR(-ENOMEM);
+        }
+        err = fib_mem_reserve(budget);
+        if (err) {
+            kfree(sh);
+            return ERR_PTR(err);
+        }
+        sh->k = k;
+        sh->mode = mode;
+        sh->fmt = fmt;
+        refcount_set(&sh->ref, 1);
+        init_completion(&sh->done);
+        sh->budget = budget;
+        sh->result.shared = true;
+
+        /* someone may have started it while this one was being set up */
+        spin_lock(&fib_shared_lock);
+        other = fib_shared_find(k, mode, fmt);
+        if (other) {
+            refcount_inc(&other->ref);
+        }
+        else {
+            hash_add(fib_shared_table, &sh->node, k);
+        }
+        spin_unlock(&fib_shared_lock);
+
+        if (!other) {
+            struct fib_progress progress;
+            fib_progress_begin(&progress, k, mode, budget);
+            err = fib_bignum_output(ctx, k, mode, fmt, &sh->result, &progress);
+            fib_progress_end(&progress);
+
+            spin_lock(&fib_shared_lock);
+            hash_del(&sh->node);
+            spin_unlock(&fib_shared_lock);
+            sh->err = err;
+            complete_all(&sh->done);
+            atomic64_inc(&fib_shared_stat.computed);
+
+            if (err) {
+                fib_shared_put(sh);
+                return ERR_PTR(err);
+            }
+            return &sh->result;
+        }
+        fib_shared_put(sh);
+        sh = other;
+    }
+
+    if (wait_for_completion_killable(&sh->done)) {
+        fib_shared_put(sh);
+        return ERR_PTR(-EINTR);
+    }
+    err = sh->err;
+    if (err) {
+        fib_shared_put(sh);
+        /* the one calculating was killed, not this one */
+        if (err == -EINTR && !fatal_signal_pending(current)) {
+            goto again;
+        }
+        return ERR_PTR(err);
+    }
+    atomic64_inc(&fib_shared_stat.joined);
+
+    return &sh->result;
+}
+
+/*
+ * function that runs a bignum request within its memory budget
+ * on success the output is in the returned result, which the caller gives
+ * back with fib_request_done() once it has been copied out
+ * return: the result, or an ERR_PTR()
+ */
+static struct fib_result *fib_request(struct fib_ctx *ctx, long long k, int mode, int fmt,
+                                      struct fib_result *spare, unsigned long *budget)
+{
+    struct fib_store_entry *entry = fib_store_find(k);
+    if (entry) {
+        atomic64_inc(&fib_store_lookups);
+        *budget = 0;
+
+        struct fib_result *res = fib_result_get(ctx, spare);
+        int err = fib_store_output(entry, fmt, res);
+        if (err) {
+            fib_result_put(ctx, res);
+            return ERR_PTR(err);
+        }
+        return res;
+    }
+
+    if (READ_ONCE(coalesce)) {
+        unsigned long bytes = fib_estimate_bytes(k, mode, fmt);
+        *budget = 0;
+        return fib_request_shared(ctx, k, mode, fmt, bytes);
+    }
+
+    *budget = fib_estimate_bytes(k, mode, fmt);
+    int err = fib_mem_reserve(*budget);
+    if (err) {
+        return ERR_PTR(err);
+    }
+
+    struct fib_progress progress;
+    fib_progress_begin(&progress, k, mode, *budget);
+
+    struct fib_result *res = fib_result_get(ctx, spare);
+    err = fib_bignum_output(ctx, k, mode, fmt, res, &progress);
+    fib_progress_end(&progress);
+    if (err) {
+        fib_result_put(ctx, res);
+        fib_mem_release(*budget);
+        return ERR_PTR(err);
+    }
+
+    return res;
+}
+
+static void fib_request_done(struct fib_ctx *ctx, struct fib_result *res, unsigned long budget)
+{
+    fib_result_put(ctx, res);
+    fib_mem_release(budget);
+}
+
+/*
+ * bring the pair that @fmt is printed from to F(@k), F(@k + 1)
+ * Hex comes from the binary pair and decimal from the base 10^18 one, so
+ * either format advances by a single addition. Only a seek pays for fast
+ * doubling, plus one conversion to seed the decimal pair.
+ */
+static int fib_gen_seek(struct fib_gen *gen, long long k, int fmt,
+                        struct fib_progress *progress)
+{
+    int err;
+
+    if (fmt == FIB_FMT_DEC && gen->dec_k == k) {
+        return 0;
+    }
+    if (gen->k != k) {
+        err = bignum_limb_fib_pair(k, gen->a, gen->b, progress);
+        gen->k = err ? -1 : k;
+        if (err) {
+            return err;
+        }
+    }
+    if (fmt != FIB_FMT_DEC) {
+        return 0;
+    }
+
+    err = bignum_limb_to_dec(gen->dec_a, gen->a);
+    if (!err) {
+        err = bignum_limb_to_dec(gen->dec_b, gen->b);
+    }
+    gen->dec_k = err ? -1 : k;
+
+    return err;
+}
+
+/* (F(k), F(k + 1)) -> (F(k + 1), F(k + 2)) in the pair of @fmt */
+static int fib_gen_next(struct fib_gen *gen, int fmt)
+{
+    if (fmt == FIB_FMT_DEC) {
+        if (bignum_dec_add(gen->dec_a, gen->dec_a, gen->dec_b)) {
+            gen->dec_k = -1;
+            return -ENOMEM;
+        }
+        swap(gen->dec_a, gen->dec_b);
+        gen->dec_k++;
+    }
+    else {
+        if (bignum_limb_add(gen->a, gen->a, gen->b)) {
+            gen->k = -1;
+            return -ENOMEM;
+        }
+        swap(gen->a, gen->b);
+        gen->k++;
+    }
+
+    return 0;
+}
+
+/* render F(@k) in @fmt and a newline into gen->text, which is reused */
+static int fib_gen_render(struct fib_gen *gen, long long k, int fmt)
+{
+    const bignum_limb *num = fmt == FIB_FMT_DEC ? gen->dec_a : gen->a;
+    size_t len;
+
+    if (gen->text_k == k && gen->text_fmt == fmt) {
+        return 0;
+    }
+
+    /* 18 digits or 16 hex digits per limb, and the newline */
+    size_t need = num->size * DEC_LIMB_DIGITS + 2;
+    if (need > gen->text_cap) {
+        /* with room to spare, the numbers only grow */
+        char *text = (char *)fib_realloc(gen->text, need * 2);
+        if (!text) {
+            return -ENOMEM;
+        }
+        gen->text = text;
+        gen->text_cap = need * 2;
+    }
+
+    if (fmt == FIB_FMT_DEC) {
+        len = bignum_dec_print(num, gen->text);
+    }
+    else {
+        len = bignum_limb_to_hex(num, gen->text);
+    }
+    /* the null terminator becomes the newline */
+    gen->text[len++] = '\n';
+
+    gen->text_len = len;
+    gen->text_k = k;
+    gen->text_fmt = fmt;
+
+    return 0;
+}
+
+/*
+ * read of a file in generator mode: as many whole numbers from F(*offset)
+ * on as fit into @size bytes, each followed by a newline
+ * return: the bytes read, 0 past max_index, or -EOVERFLOW if not even one
+ * number fits
+ */
+static ssize_t fib_gen_read(struct fib_ctx *ctx, char __user *buf, size_t size,
+                            loff_t *offset)
+{
+    struct fib_gen *gen = ctx->gen;
+    int fmt = READ_ONCE(ctx->format);
+    long long k = *offset;
+    long long last = READ_ONCE(max_index);
+    size_t done = 0;
+    int err = 0;
+
+    if (fmt == FIB_FMT_RAW || k < 0) {
+        return -EINVAL;
+    }
+    if (k > last) {
+        return 0;
+    }
+
+    unsigned long budget = fib_estimate_bytes(k, FIB_MODE_LIMB, fmt);
+    err = fib_mem_reserve(budget);
+    if (err) {
+        return err;
+    }
+    if (mutex_lock_interruptible(&gen->lock)) {
+        fib_mem_release(budget);
+        return -EINTR;
+    }
+
+    err = fib_gen_seek(gen, k, fmt, NULL);
+
+    while (!err && k <= last) {
+        err = fib_gen_render(gen, k, fmt);
+        if (err || done + gen->text_len > size) {
+            break;
+        }
+        if (copy_to_user(buf + done, gen->text, gen->text_len)) {
+            err = -EFAULT;
+            break;
+        }
+        done += gen->text_len;
+        k++;
+
+        /* a broken pair is seeded again by the next read */
+        err = fib_gen_next(gen, fmt);
+        if (err) {
+            break;
+        }
+
+        if (fib_should_stop()) {
+            break;
+        }
+    }
+
+    mutex_unlock(&gen->lock);
+    fib_mem_release(budget);
+
+    *offset = k;
+    if (done) {
+        /* a failure after some numbers shows up on the next read */
+        return done;
+    }
+    if (!err && fatal_signal_pending(current)) {
+        err = -EINTR;
+    }
+    return err ? err : -EOVERFLOW;
+}
+
+/*
+ * parallel range, see FIB_IOC_RANGE
+ *
+ * Every chunk runs a generator of its own on an unbound kernel worker and
+ * prints into a kernel buffer sized for its numbers up front. Workers have
+ * no user address space to copy to, so the caller waits for all of them,
+ * then copies the buffers out back to back, at offsets that are the sums
+ * of the lengths before them. The workers allocate as the memory cgroup of
+ * the caller, and the seeds stop on its cancel flag like the additions.
+ */
+#define FIB_RANGE_MAX_CHUNKS 64
+
+struct fib_range;
+
+struct fib_range_chunk {
+    struct work_struct work;
+    struct fib_range *range;
+    long long first;
+    long long last;
+    char *buf;
+    size_t len;
+    size_t cap;
+    int err;
+};
+
+struct fib_range {
+    int fmt;
+    bool cancel;            /* the caller was killed, stop early */
+    struct mem_cgroup *memcg;   /* of the caller, charged for the workers */
+    atomic_t pending;       /* chunks still running */
+    struct completion done;
+    struct fib_range_chunk chunk[];
+};
+
+/*
+ * upper bound of the bytes F(@first) ~ F(@last) take in @fmt with their
+ * newlines: F(k) has at most k * log10(phi) + 1 decimal digits, or
+ * k * log2(phi) / 4 + 1 hex digits
+ */
+static size_t fib_range_bytes(long long first, long long last, int fmt)
+{
+    u64 rate = fmt == FIB_FMT_DEC ? 208988 : 173561;
+    u64 count = last - first + 1;
+
+    return mult_frac((u64)(first + last) * count, rate, 2000000) + count * 2 + 1;
+}
+
+static void fib_range_work(struct work_struct *work)
+{
+    struct fib_range_chunk *c = container_of(work, struct fib_range_chunk, work);
+    struct fib_range *r = c->range;
+    struct fib_progress progress = {.cancel = &r->cancel};
+    int fmt = r->fmt;
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 10, 0)
+    struct mem_cgroup *old_memcg = set_active_memcg(r->memcg);
+#endif
+    struct fib_gen *gen = fib_gen_new();
+    int err = gen ? fib_gen_seek(gen, c->first, fmt, &progress) : -ENOMEM;
+
+    for (long long k = c->first; !err && k <= c->last; ++k) {
+        const bignum_limb *num = fmt == FIB_FMT_DEC ? gen->dec_a : gen->a;
+
+        if (c->len + fib_range_bytes(k, k, fmt) > c->cap) {
+            err = -EOVERFLOW;
+            break;
+        }
+        if (fmt == FIB_FMT_DEC) {
+            c->len += bignum_dec_print(num, c->buf + c->len);
+        }
+        else {
+            c->len += bignum_limb_to_hex(num, c->buf + c->len);
+        }
+        /* the null terminator becomes the newline */
+        c->buf[c->len++] = '\n';
+
+        if (k < c->last) {
+            err = fib_gen_next(gen, fmt);
+        }
+        cond_resched();
+        if (READ_ONCE(r->cancel)) {
+            err = -EINTR;
+        }
+    }
+
+    fib_gen_free(gen);
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 10, 0)
+    set_active_memcg(old_memcg);
+#endif
+    c->err = err;
+    if (atomic_dec_and_test(&r->pending)) {
+        complete(&r->done);
+    }
+}
+
+/*
+ * cut F(@first) ~ F(@last) into @chunks pieces of about equal work
+ * Streaming F(k) costs about k, so the work up to k grows as k^2 and the
+ * cuts are at equal steps of the square.
+ */
+static void fib_range_split(struct fib_range *r, int chunks, long long first,
+                            long long last)
+{
+    u64 lo = (u64) first * first;
+    u64 hi = (u64)(last + 1) * (last + 1);
+    long long start = first;
+
+    for (int i = 0; i < chunks; ++i) {
+        long long end = int_sqrt64(lo + mult_frac(hi - lo, (u64)(i + 1), (u64) chunks));
+
+        /* at least one number per chunk, and the last one ends the range */
+        end = clamp_t(long long, end, start + 1, last + 1 - (chunks - 1 - i));
+        if (i == chunks - 1) {
+            end = last + 1;
+        }
+        r->chunk[i].range = r;
+        r->chunk[i].first = start;
+        r->chunk[i].last = end - 1;
+        start = end;
+    }
+}
+
+static long fib_range(struct fib_ctx *ctx, struct fib_range_req __user *ureq)
+{
+    struct fib_range_req req;
+    struct fib_range *r;
+    int fmt = READ_ONCE(ctx->format);
+    size_t len = 0;
+    int err = 0;
+
+    if (copy_from_user(&req, ureq, sizeof(req))) {
+        return -EFAULT;
+    }
+    if (fmt == FIB_FMT_RAW || req.first < 0 || req.last < req.first ||
+        req.last > READ_ONCE(max_index)) {
+        return -EINVAL;
+    }
+    /* keeps the squares of fib_range_split() in 64 bits */
+    if (req.last >= S32_MAX) {
+        return -E2BIG;
+    }
+
+    long long count = req.last - req.first + 1;
+    int chunks = req.chunks ? min_t(u32, req.chunks, FIB_RANGE_MAX_CHUNKS) : num_online_cpus();
+    chunks = min_t(long long, min(chunks, FIB_RANGE_MAX_CHUNKS), count);
+
+    /* the output, and the pairs of every generator */
+    unsigned long budget = fib_range_bytes(req.first, req.last, fmt) +
+                           chunks * fib_estimate_bytes(req.last, FIB_MODE_LIMB, fmt);
+    err = fib_mem_reserve(budget);
+    if (err) {
+        return err;
+    }
+
+    r = kzalloc(struct_size(r, chunk, chunks), GFP_KERNEL);
+    if (!r) {
+        fib_mem_release(budget);
+        return -ENOMEM;
+    }
+    r->fmt = fmt;
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 10, 0)
+    r->memcg = get_mem_cgroup_from_mm(current->mm);
+#endif
+    atomic_set(&r->pending, chunks);
+    init_completion(&r->done);
+    fib_range_split(r, chunks, req.first, req.last);
+
+    for (int i = 0; i < chunks && !err; ++i) {
+        struct fib_range_chunk *c = &r->chunk[i];
+        c->cap = fib_range_bytes(c->first, c->last, fmt);
+        c->buf = (char *)fib_alloc(c->cap);
+        if (!c->buf) {
+            err = -ENOMEM;
+        }
+    }
+
+    if (!err) {
+        for (int i = 0; i < chunks; ++i) {
+            INIT_WORK(&r->chunk[i].work, fib_range_work);
+            queue_work(system_unbound_wq, &r->chunk[i].work);
+        }
+        if (wait_for_completion_killable(&r->done)) {
+            /* the workers still use r, so wait for them to notice */
+            WRITE_ONCE(r->cancel, true);
+            wait_for_completion(&r->done);
+        }
+        for (int i = 0; i < chunks; ++i) {
+            if (!err) {
+                err = r->chunk[i].err;
+            }
+            len += r->chunk[i].len;
+        }
+    }
+
+    if (!err) {
+        req.len = len;
+        if (len > req.size) {
+            err = -EOVERFLOW;
+        }
+    }
+    if (!err) {
+        char __user *dst = u64_to_user_ptr(req.buf);
+        for (int i = 0; i < chunks; ++i) {
+            if (copy_to_user(dst, r->chunk[i].buf, r->chunk[i].len)) {
+                err = -EFAULT;
+                break;
+            }
+            dst += r->chunk[i].len;
+        }
+    }
+
+    for (int i = 0; i < chunks; ++i) {
+        fib_free(r->chunk[i].buf);
+    }
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 10, 0)
+    mem_cgroup_put(r->memcg);
+#endif
+    kfree(r);
+    fib_mem_release(budget);
+
+    if ((!err || err == -EOVERFLOW) && copy_to_user(ureq, &req, sizeof(req))) {
+        return -EFAULT;
+    }
+    return err;
+}
+
+/*
+ * calculate the fibonacci number at given offset
+ * the offset is the file position for read, or the one given to pread,
+ * which lets threads sharing a file descriptor skip lseek altogether
+ */
+static ssize_t fib_read(struct file *file,
+                        char *buf,
+                        size_t size,
+                        loff_t *offset)
+{
+    struct fib_ctx *ctx = file->private_data;
+    if (smp_load_acquire(&ctx->generator)) {
+        return fib_gen_read(ctx, buf, size, offset);
+    }
+
+    int mode = size & FIB_MODE_MASK;
+    int fmt = fib_request_format(file, size);
+
+    /* lseek clamps the file position, but pread hands any offset in */
+    if (*offset < 0 || *offset > READ_ONCE(max_index)) {
+        return -EINVAL;
+    }
+
+    if (mode == 0) {
+        return (ssize_t) fib_sequence(*offset);
+    }
+    else if (mode == 1) {
+        return (ssize_t) fast_doubling(*offset);
+    }
+    else if (mode == 2) {
+        return (ssize_t) fast_doubling_clz(*offset);
+    }
+    else if (mode >= FIB_MODE_NR) {
+        return 0;
+    }
+
+    struct fib_result spare;
+    unsigned long budget;
+    struct fib_result *res = fib_request(ctx, *offset, mode, fmt, &spare, &budget);
+    if (IS_ERR(res)) {
+        return PTR_ERR(res);
+    }
+
+    ssize_t retval = copy_to_user(buf, res->buf, res->len);
+    if (retval == 0) {
+        retval = res->len;
+    }
+    else {
+        retval = -EFAULT;
+    }
+
+    fib_request_done(ctx, res, budget);
+    
+    return retval;
+}
+
+/*
+ * read_iter, used by readv, preadv and io_uring
+ * the algorithm comes from the open file and the index from the request
+ * offset, the result is written into the buffers in the format of the file
+ */
+static ssize_t fib_read_iter(struct kiocb *iocb, struct iov_iter *to)
+{
+    struct fib_ctx *ctx = iocb->ki_filp->private_data;
+    int mode = READ_ONCE(ctx->mode);
+    int fmt = READ_ONCE(ctx->format);
+    long long k = iocb->ki_pos;
+    size_t room = iov_iter_count(to);
+
+    if (k < 0 || k > READ_ONCE(max_index)) {
+        return -EINVAL;
+    }
+
+    if (mode <= 2) {
+        /* the native modes render their 64-bit result the same way */
+        u64 value;
+        if (mode == 0) {
+            value = fib_sequence(k);
+        }
+        else if (mode == 1) {
+            value = fast_doubling(k);
+        }
+        else {
+            value = fast_doubling_clz(k);
+        }
+
+        char tmp[24];
+        size_t len;
+        if (fmt == FIB_FMT_DEC) {
+            len = scnprintf(tmp, sizeof(tmp), "%llu", value) + 1;
+        }
+        else if (fmt == FIB_FMT_HEX) {
+            len = scnprintf(tmp, sizeof(tmp), "%llx", value) + 1;
+        }
+        else {
+            __le64 raw = cpu_to_le64(value);
+            memcpy(tmp, &raw, sizeof(raw));
+            len = sizeof(raw);
+        }
+
+        if (len > room) {
+            return -EOVERFLOW;
+        }
+        return copy_to_iter(tmp, len, to) == len ? len : -EFAULT;
+    }
+
+    struct fib_result spare;
+    unsigned long budget;
+    struct fib_result *res = fib_request(ctx, k, mode, fmt, &spare, &budget);
+    if (IS_ERR(res)) {
+        return PTR_ERR(res);
+    }
+
+    ssize_t retval;
+    if (res->len > room) {
+        retval = -EOVERFLOW;
+    }
+    else if (copy_to_iter(res->buf, res->len, to) != res->len) {
+        retval = -EFAULT;
+    }
+    else {
+        retval = res->len;
+    }
+
+    fib_request_done(ctx, res, budget);
+
+    return retval;
+}
+
+static ssize_t fib_write(struct file *file,
+                         const char *buf,
+                         size_t size,
+                         loff_t *offset)
+{
+    ktime_t start_time, end_time;
+    s64 elapsed_time;
+    int mode = size & FIB_MODE_MASK;
+    int fmt = fib_request_format(file, size);
+
+    if (*offset < 0 || *offset > READ_ONCE(max_index)) {
+        return -EINVAL;
+    }
+
+    if (mode == 0) {
+        /* test the execution time of iterative version of fibonacci number */
+        start_time = ktime_get();
+        fib_sequence(*offset);
+        end_time = ktime_get();
+    } else if (mode == 1) {
+        /* test the execution time of fast doubling version */
+        start_time = ktime_get();
+        fast_doubling(*offset);
+        end_time = ktime_get();
+    } else if (mode == 2) {
+        /* test the execution time of fast doubling version using clz */
+        start_time = ktime_get();
+        fast_doubling_clz(*offset);
+        end_time = ktime_get();
+    } else if (mode < FIB_MODE_NR) {
+        /* test the execution time of the bignum modes, including rendering
+         * the result in the requested format
+         *
+         * mode == 3: bignum_decimal
+         * mode == 4: bignum_bin_fibonacci
+         * mode == 5: bignum_bin_fast_doubling
+         * mode == 6: bignum_bin_fast_doubling_clz
+         * mode == 7: bignum_fast_doubling_clz
+         * mode == 8: bignum_limb_fibonacci
+         * mode == 9: bignum_limb_matrix
+         * mode == 10: bignum_limb_lucas
+         */
+        unsigned long budget = fib_estimate_bytes(*offset, mode, fmt);
+        int err = fib_mem_reserve(budget);
+        if (err) {
+            return err;
+        }
+
+        struct fib_ctx *ctx = file->private_data;
+        struct fib_result spare;
+        struct fib_result *res = fib_result_get(ctx, &spare);
+        struct fib_progress progress;
+        fib_progress_begin(&progress, *offset, mode, budget);
+
+        start_time = ktime_get();
+        err = fib_bignum_output(ctx, *offset, mode, fmt, res, &progress);
+        end_time = ktime_get();
+
+        fib_progress_end(&progress);
+
+        fib_result_put(ctx, res);
+        fib_mem_release(budget);
+        if (err) {
+            return err;
+        }
+    } else {
+        return 0;
+    }
+    
+    elapsed_time = ktime_to_ns(ktime_sub(end_time, start_time));
+    return elapsed_time;
+}
+
+static long fib_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
+{
+    struct fib_ctx *ctx = file->private_data;
+    int __user *argp = (int __user *)arg;
+    int fmt, mode;
+
+    switch (cmd) {
+    case FIB_IOC_SET_FORMAT:
+        if (get_user(fmt, argp))
+            return -EFAULT;
+        if (fmt < 0 || fmt >= FIB_FMT_NR)
+            return -EINVAL;
+        WRITE_ONCE(ctx->format, fmt);
+        return 0;
+    case FIB_IOC_GET_FORMAT:
+        return put_user(ctx->format, argp);
+    case FIB_IOC_SET_MODE:
+        if (get_user(mode, argp))
+            return -EFAULT;
+        if (mode < 0 || mode >= FIB_MODE_NR)
+            return -EINVAL;
+        WRITE_ONCE(ctx->mode, mode);
+        return 0;
+    case FIB_IOC_GET_MODE:
+        return put_user(ctx->mode, argp);
+    case FIB_IOC_SET_GENERATOR: {
+        int on;
+        if (get_user(on, argp))
+            return -EFAULT;
+        if (on && !READ_ONCE(ctx->gen)) {
+            /* the generator stays until release, so readers never lose it */
+            struct fib_gen *gen = fib_gen_new();
+            if (!gen)
+                return -ENOMEM;
+            if (cmpxchg(&ctx->gen, NULL, gen))
+                fib_gen_free(gen);
+        }
+        smp_store_release(&ctx->generator, !!on);
+        return 0;
+    }
+    case FIB_IOC_GET_GENERATOR:
+        return put_user((int) READ_ONCE(ctx->generator), argp);
+    case FIB_IOC_MOD: {
+        struct fib_mod_req req;
+        if (copy_from_user(&req, (void __user *)arg, sizeof(req)))
+            return -EFAULT;
+        if (req.m == 0)
+            return -EINVAL;
+        req.result = fib_mod(req.n, req.m);
+        if (fatal_signal_pending(current))
+            return -EINTR;
+        return copy_to_user((void __user *)arg, &req, sizeof(req)) ? -EFAULT : 0;
+    }
+    case FIB_IOC_RANGE:
+        return fib_range(ctx, (struct fib_range_req __user *)arg);
+    default:
+        return -ENOTTY;
+    }
+}
+
+static loff_t fib_device_lseek(struct file *file, loff_t offset, int orig)
+{
+    loff_t new_pos = 0;
+    switch (orig) {
+    case 0: /* SEEK_SET: */
+        new_pos = offset;
+        break;
+    case 1: /* SEEK_CUR: */
+        new_pos = file->f_pos + offset;
+        break;
+    case 2: /* SEEK_END: */
+        new_pos = max_index - offset;
+        break;
+    }
+
+    if (new_pos > max_index)
+        new_pos = max_index;  // max case
+    if (new_pos < 0)
+        new_pos = 0;        // min case
+    file->f_pos = new_pos;  // This is what we'll use now
+    return new_pos;
+}
+
+/* allocator counters, under /sys/class/fibonacci/fibonacci/alloc/ */
+static ssize_t allocs_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    return sysfs_emit(buf, "%lld\n", atomic64_read(&fib_alloc_stat.allocs));
+}
+static DEVICE_ATTR_RO(allocs);
+
+static ssize_t frees_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    return sysfs_emit(buf, "%lld\n", atomic64_read(&fib_alloc_stat.frees));
+}
+static DEVICE_ATTR_RO(frees);
+
+static ssize_t bytes_in_use_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    return sysfs_emit(buf, "%lld\n", atomic64_read(&fib_alloc_stat.bytes_in_use));
+}
+static DEVICE_ATTR_RO(bytes_in_use);
+
+static ssize_t bytes_peak_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    return sysfs_emit(buf, "%lld\n", atomic64_read(&fib_alloc_stat.bytes_peak));
+}
+static DEVICE_ATTR_RO(bytes_peak);
+
+/* memory budget counters, under /sys/class/fibonacci/fibonacci/mem/ */
+static ssize_t reserved_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    return sysfs_emit(buf, "%lld\n", atomic64_read(&fib_mem_stat.reserved));
+}
+static DEVICE_ATTR_RO(reserved);
+
+static ssize_t reserved_peak_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    return sysfs_emit(buf, "%lld\n", atomic64_read(&fib_mem_stat.reserved_peak));
+}
+static DEVICE_ATTR_RO(reserved_peak);
+
+static ssize_t rejected_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    return sysfs_emit(buf, "%lld\n", atomic64_read(&fib_mem_stat.rejected));
+}
+static DEVICE_ATTR_RO(rejected);
+
+static struct attribute *fib_alloc_attrs[] = {
+    &dev_attr_allocs.attr,
+    &dev_attr_frees.attr,
+    &dev_attr_bytes_in_use.attr,
+    &dev_attr_bytes_peak.attr,
+    NULL,
+};
+
+static const struct attribute_group fib_alloc_group = {
+    .name = "alloc",
+    .attrs = fib_alloc_attrs,
+};
+
+static struct attribute *fib_mem_attrs[] = {
+    &dev_attr_reserved.attr,
+    &dev_attr_reserved_peak.attr,
+    &dev_attr_rejected.attr,
+    NULL,
+};
+
+static const struct attribute_group fib_mem_group = {
+    .name = "mem",
+    .attrs = fib_mem_attrs,
+};
+
+/* memo counters of mode 8, under /sys/class/fibonacci/fibonacci/memo/ */
+static ssize_t hits_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    return sysfs_emit(buf, "%lld\n", atomic64_read(&fib_memo_stat.hits));
+}
+static DEVICE_ATTR_RO(hits);
+
+static ssize_t steps_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    return sysfs_emit(buf, "%lld\n", atomic64_read(&fib_memo_stat.steps));
+}
+static DEVICE_ATTR_RO(steps);
+
+static ssize_t jumps_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    return sysfs_emit(buf, "%lld\n", atomic64_read(&fib_memo_stat.jumps));
+}
+static DEVICE_ATTR_RO(jumps);
+
+static ssize_t misses_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    return sysfs_emit(buf, "%lld\n", atomic64_read(&fib_memo_stat.misses));
+}
+static DEVICE_ATTR_RO(misses);
+
+static struct attribute *fib_memo_attrs[] = {
+    &dev_attr_hits.attr,
+    &dev_attr_steps.attr,
+    &dev_attr_jumps.attr,
+    &dev_attr_misses.attr,
+    NULL,
+};
+
+static const struct attribute_group fib_memo_group = {
+    .name = "memo",
+    .attrs = fib_memo_attrs,
+};
+
+/* precomputed store, under /sys/class/fibonacci/fibonacci/store/ */
+static ssize_t entries_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct fib_store *s = smp_load_acquire(&fib_store);
+    return sysfs_emit(buf, "%u\n", s ? s->count : 0);
+}
+static DEVICE_ATTR_RO(entries);
+
+static ssize_t bytes_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct fib_store *s = smp_load_acquire(&fib_store);
+    return sysfs_emit(buf, "%zu\n", s ? s->bytes : 0);
+}
+static DEVICE_ATTR_RO(bytes);
+
+static ssize_t load_ns_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct fib_store *s = smp_load_acquire(&fib_store);
+    return sysfs_emit(buf, "%lld\n", s ? s->load_ns : 0);
+}
+static DEVICE_ATTR_RO(load_ns);
+
+static ssize_t lookups_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    return sysfs_emit(buf, "%lld\n", atomic64_read(&fib_store_lookups));
+}
+static DEVICE_ATTR_RO(lookups);
+
+static struct attribute *fib_store_attrs[] = {
+    &dev_attr_entries.attr,
+    &dev_attr_bytes.attr,
+    &dev_attr_load_ns.attr,
+    &dev_attr_lookups.attr,
+    NULL,
+};
+
+static const struct attribute_group fib_store_group = {
+    .name = "store",
+    .attrs = fib_store_attrs,
+};
+
+/* request coalescing, under /sys/class/fibonacci/fibonacci/coalesce/ */
+static ssize_t computed_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    return sysfs_emit(buf, "%lld\n", atomic64_read(&fib_shared_stat.computed));
+}
+static DEVICE_ATTR_RO(computed);
+
+static ssize_t joined_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    return sysfs_emit(buf, "%lld\n", atomic64_read(&fib_shared_stat.joined));
+}
+static DEVICE_ATTR_RO(joined);
+
+static struct attribute *fib_coalesce_attrs[] = {
+    &dev_attr_computed.attr,
+    &dev_attr_joined.attr,
+    NULL,
+};
+
+static const struct attribute_group fib_coalesce_group = {
+    .name = "coalesce",
+    .attrs = fib_coalesce_attrs,
+};
+
+static const struct attribute_group *fib_groups[] = {
+    &fib_alloc_group,
+    &fib_mem_group,
+    &fib_memo_group,
+    &fib_store_group,
+    &fib_coalesce_group,
+    NULL,
+};
+
+/* the requests in flight, one line each, under <debugfs>/fibonacci/requests */
+static int fib_requests_show(struct seq_file *m, void *v)
+{
+    struct fib_progress *p;
+    ktime_t now = ktime_get();
+
+    /* comm goes last, it may hold spaces */
+    seq_puts(m, "pid index mode step steps bytes elapsed_us comm\n");
+    spin_lock(&fib_progress_lock);
+    list_for_each_entry(p, &fib_progress_list, node) {
+        seq_printf(m, "%d %lld %d %lld %lld %lu %lld %s\n", p->pid, p->k, p->mode,
+                   READ_ONCE(p->step), p->steps, p->bytes,
+                   ktime_to_us(ktime_sub(now, p->start)), p->comm);
+    }
+    spin_unlock(&fib_progress_lock);
+
+    return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(fib_requests);
+
+static struct dentry *fib_debugfs;
+
+const struct file_operations fib_fops = {
+    .owner = THIS_MODULE,
+    .read = fib_read,
+    .read_iter = fib_read_iter,
+    .write = fib_write,
+    .open = fib_open,
+    .release = fib_release,
+    .llseek = fib_device_lseek,
+    .unlocked_ioctl = fib_ioctl,
+    .compat_ioctl = compat_ptr_ioctl,
+};
+
+static int __init init_fib_dev(void)
+{
+    int rc = 0;
+    mutex_init(&fib_mutex);
+
+    rc = fib_alloc_init();
+    if (rc < 0) {
+        printk(KERN_ALERT "Failed to create bignum caches\n");
+        return rc;
+    }
+
+    // Let's register the device
+    // This will dynamically allocate the major number
+    rc = major = register_chrdev(major, DEV_FIBONACCI_NAME, &fib_fops);
+    if (rc < 0) {
+        printk(KERN_ALERT "Failed to add cdev\n");
         rc = -2;
         goto failed_cdev;
     }
@@ -1090,26 +4505,44 @@ static int __init init_fib_dev(void)
         goto failed_class_create;
     }
 
-    if (!device_create(fib_class, NULL, fib_dev, NULL, DEV_FIBONACCI_NAME)) {
+    struct device *dev = device_create_with_groups(fib_class, NULL, fib_dev, NULL,
+                                                   fib_groups, DEV_FIBONACCI_NAME);
+    if (!dev) {
         printk(KERN_ALERT "Failed to create device\n");
         rc = -4;
         goto failed_device_create;
     }
+
+    /* debugfs is optional, the driver works without it */
+    fib_debugfs = debugfs_create_dir(DEV_FIBONACCI_NAME, NULL);
+    debugfs_create_file("requests", 0444, fib_debugfs, NULL, &fib_requests_fops);
+
+    /* the driver works without it, only slower on the stored indices */
+    if (store && *store) {
+        int err = fib_store_load(dev);
+        if (err) {
+            printk(KERN_WARNING "fibdrv: store %s not loaded (%d)\n", store, err);
+        }
+    }
     return rc;
 failed_device_create:
     class_destroy(fib_class);
 failed_class_create:
 failed_cdev:
     unregister_chrdev(major, DEV_FIBONACCI_NAME);
+    fib_alloc_exit();
     return rc;
 }
 
 static void __exit exit_fib_dev(void)
 {
     mutex_destroy(&fib_mutex);
+    debugfs_remove_recursive(fib_debugfs);
     device_destroy(fib_class, fib_dev);
     class_destroy(fib_class);
     unregister_chrdev(major, DEV_FIBONACCI_NAME);
+    fib_store_free();
+    fib_alloc_exit();
 }
 
 module_init(init_fib_dev);
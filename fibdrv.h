@@ -0,0 +1,135 @@
+#ifndef FIBDRV_H
+#define FIBDRV_H
+
+/* interface shared by the fibdrv module and its userspace clients */
+
+#include <linux/ioctl.h>
+#include <linux/types.h>
+
+/* algorithms, selected by the "size" of read/write or by FIB_IOC_SET_MODE */
+enum fib_mode {
+    FIB_MODE_SEQUENCE = 0,              /* fib_sequence */
+    FIB_MODE_FAST_DOUBLING = 1,         /* fast_doubling */
+    FIB_MODE_FAST_DOUBLING_CLZ = 2,     /* fast_doubling_clz */
+    FIB_MODE_DECIMAL = 3,               /* bignum_decimal_fibonacci */
+    FIB_MODE_BIN = 4,                   /* bignum_bin_fibonacci */
+    FIB_MODE_BIN_FAST_DOUBLING = 5,     /* bignum_bin_fast_doubling */
+    FIB_MODE_BIN_FAST_DOUBLING_CLZ = 6, /* bignum_bin_fast_doubling_clz */
+    FIB_MODE_BIGNUM_FAST_DOUBLING_CLZ = 7, /* bignum_fast_doubling_clz */
+    FIB_MODE_LIMB = 8,                  /* bignum_limb_fibonacci, memoized */
+    FIB_MODE_LIMB_MATRIX = 9,           /* bignum_limb_matrix */
+    FIB_MODE_LIMB_LUCAS = 10,           /* bignum_limb_lucas */
+    FIB_MODE_NR,
+};
+
+/* output formats of the bignum modes (size 3 ~ 10) */
+enum fib_format {
+    FIB_FMT_DEC = 0, /* null terminated decimal string (default) */
+    FIB_FMT_HEX = 1, /* null terminated lowercase hex string, no "0x" */
+    FIB_FMT_RAW = 2, /* little-endian 64-bit limbs, no terminator */
+    FIB_FMT_NR,
+};
+
+/*
+ * The "size" parameter of read/write selects the algorithm in its low byte.
+ * Bits 8 ~ 9 may override the output format of the open file for that
+ * single request, e.g. read(fd, buf, FIB_SIZE(6, FIB_FMT_HEX)).
+ * A plain size (bits 8 ~ 9 are zero) uses the format of the open file.
+ * As with any read, the buffer should be at least "size" bytes long.
+ */
+#define FIB_MODE_MASK 0xff
+#define FIB_FMT_SHIFT 8
+#define FIB_FMT_MASK 0x3
+#define FIB_SIZE(mode, fmt) ((mode) | (((fmt) + 1) << FIB_FMT_SHIFT))
+
+/*
+ * read(2) keeps the "size" convention above. Vectored and asynchronous reads
+ * (readv, preadv, io_uring) go through read_iter instead: there the buffer
+ * length is a real length, the algorithm is the one set by FIB_IOC_SET_MODE
+ * and the index is the file offset of the request. Every mode, including
+ * 0 ~ 2, then writes its result into the buffer in the format of the file;
+ * a buffer too small for the result fails with EOVERFLOW.
+ */
+
+#define FIB_IOC_MAGIC 'f'
+
+/* set/get the output format of the open file, the argument is an int */
+#define FIB_IOC_SET_FORMAT _IOW(FIB_IOC_MAGIC, 1, int)
+#define FIB_IOC_GET_FORMAT _IOR(FIB_IOC_MAGIC, 2, int)
+
+/* set/get the algorithm of read_iter for the open file, the argument is an int */
+#define FIB_IOC_SET_MODE _IOW(FIB_IOC_MAGIC, 3, int)
+#define FIB_IOC_GET_MODE _IOR(FIB_IOC_MAGIC, 4, int)
+
+/*
+ * F(n) mod m, for any 64-bit n and m > 0, without going through bignums
+ * fill in n and m, the residue comes back in result
+ */
+struct fib_mod_req {
+    __u64 n;
+    __u64 m;
+    __u64 result;
+};
+#define FIB_IOC_MOD _IOWR(FIB_IOC_MAGIC, 5, struct fib_mod_req)
+
+/*
+ * turn the generator mode of the open file on (1) or off (0), the argument
+ * is an int
+ *
+ * In generator mode read(2) streams the sequence: "size" is a real buffer
+ * length, and the read returns as many whole numbers from F(pos) on as fit,
+ * each followed by a newline, in the decimal or hex format of the file (raw
+ * fails with EINVAL). The file position moves past them, so back to back
+ * reads continue where the last one stopped at the cost of one addition
+ * per number. lseek or pread elsewhere restart from that index. A read
+ * past max_index returns 0, a buffer too small for the next number fails
+ * with EOVERFLOW.
+ */
+#define FIB_IOC_SET_GENERATOR _IOW(FIB_IOC_MAGIC, 6, int)
+#define FIB_IOC_GET_GENERATOR _IOR(FIB_IOC_MAGIC, 7, int)
+
+/*
+ * F(first) ~ F(last) in one call, spread over the CPUs
+ *
+ * The range is cut into "chunks" pieces of about equal work (0 picks one
+ * per online CPU), each seeded by fast doubling and streamed by additions
+ * on a kernel worker. buf receives the numbers back to back as the
+ * generator writes them: decimal or hex by the format of the file, each
+ * followed by a newline (raw fails with EINVAL). len comes back as the
+ * bytes written, or, with EOVERFLOW, as the size buf needs.
+ */
+struct fib_range_req {
+    __s64 first;
+    __s64 last;
+    __u64 buf;
+    __u64 size;
+    __u64 len;
+    __u32 chunks;
+    __u32 pad;
+};
+#define FIB_IOC_RANGE _IOWR(FIB_IOC_MAGIC, 8, struct fib_range_req)
+
+/*
+ * precomputed store, made by fib_store.c and loaded by the module through
+ * request_firmware() when the "store" parameter names it
+ *
+ * a struct fib_store_hdr, then "count" records: a struct fib_store_rec
+ * followed by its "limbs" 64-bit limbs of F(k), least significant first
+ * every field is little-endian, crc is the CRC-32 (as in zlib) of the limbs
+ */
+#define FIB_STORE_MAGIC 0x45524f5453424946ULL /* "FIBSTORE" */
+#define FIB_STORE_VERSION 1
+
+struct fib_store_hdr {
+    __u64 magic;
+    __u32 version;
+    __u32 count;
+};
+
+struct fib_store_rec {
+    __u64 k;
+    __u32 limbs;
+    __u32 crc;
+};
+
+#endif /* FIBDRV_H */
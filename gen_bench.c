@@ -0,0 +1,135 @@
+/* gen_bench.c */
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "fibdrv.h"
+
+/*
+ * Throughput of the generator mode against the lseek + read loop of
+ * get_fib_bignum.c, in numbers per second, for F(start) ~ F(start + count - 1)
+ * in decimal. The loop asks for every index on its own through a bignum
+ * "mode" (3 ~ 10), the generator streams them with reads of "buffer" bytes.
+ * Both streams are hashed, and a mismatch is reported.
+ *
+ * One CSV row per method:
+ *
+ *   method,numbers,seconds,numbers_per_sec
+ *
+ * usage: gen_bench [mode] [start] [count] [buffer size]
+ *
+ * The module has to allow start + count - 1 (max_index).
+ */
+
+#define FIB_DEV "/dev/fibonacci"
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* FNV-1a, run over the numbers and their newlines */
+static uint64_t hash(uint64_t h, const char *s, size_t len)
+{
+    for (size_t i = 0; i < len; ++i) {
+        h = (h ^ (unsigned char) s[i]) * 0x100000001b3ULL;
+    }
+    return h;
+}
+
+#define HASH_INIT 0xcbf29ce484222325ULL
+
+static void report(const char *method, long long numbers, uint64_t ns)
+{
+    double sec = ns / 1e9;
+    printf("%s,%lld,%.6f,%.0f\n", method, numbers, sec, sec > 0 ? numbers / sec : 0);
+}
+
+int main(int argc, char *argv[])
+{
+    int mode = argc > 1 ? atoi(argv[1]) : FIB_MODE_LIMB;
+    long long start = argc > 2 ? atoll(argv[2]) : 0;
+    long long count = argc > 3 ? atoll(argv[3]) : 10000;
+    size_t size = argc > 4 ? strtoul(argv[4], NULL, 0) : 1 << 20;
+    /* F(k) has about 0.209 k decimal digits */
+    size_t number_size = (start + count) / 4 + 64;
+
+    if (mode < FIB_MODE_DECIMAL || mode >= FIB_MODE_NR || start < 0 || count < 1) {
+        fprintf(stderr, "usage: %s [mode] [start] [count] [buffer size]\n", argv[0]);
+        exit(1);
+    }
+    if (size < number_size) {
+        size = number_size;
+    }
+
+    int fd = open(FIB_DEV, O_RDWR);
+    if (fd < 0) {
+        perror("Failed to open character device");
+        exit(1);
+    }
+    char *buf = malloc(size);
+    if (!buf) {
+        perror("malloc");
+        exit(1);
+    }
+
+    printf("method,numbers,seconds,numbers_per_sec\n");
+
+    /* one lseek + read per index */
+    uint64_t loop_hash = HASH_INIT;
+    uint64_t t = now_ns();
+    for (long long k = start; k < start + count; ++k) {
+        lseek(fd, k, SEEK_SET);
+        if (read(fd, buf, FIB_SIZE(mode, FIB_FMT_DEC)) < 0) {
+            perror("read");
+            exit(1);
+        }
+        loop_hash = hash(loop_hash, buf, strlen(buf));
+        loop_hash = hash(loop_hash, "\n", 1);
+    }
+    report("lseek_read", count, now_ns() - t);
+
+    /* the generator, as many numbers per read as fit */
+    int on = 1;
+    if (ioctl(fd, FIB_IOC_SET_GENERATOR, &on) < 0) {
+        perror("FIB_IOC_SET_GENERATOR");
+        exit(1);
+    }
+    uint64_t gen_hash = HASH_INIT;
+    long long numbers = 0;
+    t = now_ns();
+    lseek(fd, start, SEEK_SET);
+    while (numbers < count) {
+        ssize_t len = read(fd, buf, size);
+        if (len <= 0) {
+            perror(len < 0 ? "read" : "read past max_index");
+            exit(1);
+        }
+        /* the last read may overshoot, only the first count numbers count */
+        char *p = buf, *end = buf + len;
+        while (p < end && numbers < count) {
+            char *nl = memchr(p, '\n', end - p);
+            gen_hash = hash(gen_hash, p, nl - p + 1);
+            p = nl + 1;
+            numbers++;
+        }
+    }
+    report("generator", numbers, now_ns() - t);
+
+    if (gen_hash != loop_hash) {
+        fprintf(stderr, "the generator and the loop disagree\n");
+        exit(1);
+    }
+
+    free(buf);
+    close(fd);
+    return 0;
+}
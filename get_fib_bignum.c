@@ -27,9 +27,12 @@ int main()
                            "Fibonacci by bignum_bin fibonacci",
                            "Fibonacci by bignum_bin fast_doubling",
                            "Fibonacci by bignum_bin fast_doubling_clz",
-                           "Fibonacci by BIGNUM fast_doubling_clz"};
+                           "Fibonacci by BIGNUM fast_doubling_clz",
+                           "Fibonacci by bignum_limb with memo",
+                           "Fibonacci by bignum_limb matrix",
+                           "Fibonacci by bignum_limb lucas"};
     
-    for (int j = 3; j <= 7; ++j) {
+    for (int j = 3; j <= 10; ++j) {
         printf("\n%s\n", print_title[j]);
 
         for (int i = 1; i <= OFFSET; i++) {
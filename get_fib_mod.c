@@ -0,0 +1,77 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/ioctl.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "fibdrv.h"
+
+#define FIB_DEV "/dev/fibonacci"
+#define ITERATIONS 100000
+
+/*
+ * usage: get_fib_mod <n> <m>   prints F(n) mod m
+ *        get_fib_mod           times FIB_IOC_MOD for random 64-bit n and
+ *                              moduli of 2 ~ 64 bits, odd and even
+ */
+
+static unsigned long long rand64(void)
+{
+    return ((unsigned long long) rand() << 62) ^ ((unsigned long long) rand() << 31) ^ rand();
+}
+
+static long long mod_time(int fd, unsigned long long m)
+{
+    struct fib_mod_req req = {.m = m};
+    struct timespec start, end;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < ITERATIONS; ++i) {
+        req.n = rand64();
+        req.m = m;
+        if (ioctl(fd, FIB_IOC_MOD, &req) < 0) {
+            perror("FIB_IOC_MOD");
+            exit(1);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    return ((end.tv_sec - start.tv_sec) * 1000000000LL + (end.tv_nsec - start.tv_nsec)) /
+           ITERATIONS;
+}
+
+int main(int argc, char *argv[])
+{
+    int fd = open(FIB_DEV, O_RDWR);
+    if (fd < 0) {
+        perror("Failed to open character device");
+        exit(1);
+    }
+
+    if (argc == 3) {
+        struct fib_mod_req req = {
+            .n = strtoull(argv[1], NULL, 0),
+            .m = strtoull(argv[2], NULL, 0),
+        };
+        if (ioctl(fd, FIB_IOC_MOD, &req) < 0) {
+            perror("FIB_IOC_MOD");
+            exit(1);
+        }
+        printf("%llu\n", (unsigned long long) req.result);
+        close(fd);
+        return 0;
+    }
+
+    /* bits of m, ns per odd m, ns per even m (the CRT path) */
+    for (int bits = 2; bits <= 64; ++bits) {
+        unsigned long long top = 1ULL << (bits - 1);
+        unsigned long long odd = top | (rand64() & (top - 1)) | 1;
+        unsigned long long even = top | ((rand64() & (top - 1)) & ~1ULL);
+        printf("%d %lld %lld\n", bits, mod_time(fd, odd), mod_time(fd, even));
+    }
+
+    close(fd);
+    return 0;
+}
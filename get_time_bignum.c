@@ -26,6 +26,8 @@ int main()
         unsigned long long time5 = write(fd, buf, 5);
         unsigned long long time6 = write(fd, buf, 6);
         unsigned long long time7 = write(fd, buf, 7);
+        unsigned long long time9 = write(fd, buf, 9);
+        unsigned long long time10 = write(fd, buf, 10);
         /* Here, I use the "size_t size" parameter of write system call to
          * specify which fibonacci function to call
          *
@@ -34,8 +36,11 @@ int main()
          * size == 5: will call bignum_bin_fast_doubling
          * size == 6: will call bignum_bin_fast_doubling_clz
          * size == 7: will call BIGNUM_fast_doubling_clz
+         * size == 9: will call bignum_limb_matrix
+         * size == 10: will call bignum_limb_lucas
          */
-        printf("%d %llu %llu %llu %llu %llu\n", i, time3, time4, time5, time6, time7);
+        printf("%d %llu %llu %llu %llu %llu %llu %llu\n", i, time3, time4, time5, time6, time7,
+               time9, time10);
     }
     close(fd);
     return 0;
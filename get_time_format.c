@@ -0,0 +1,43 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "fibdrv.h"
+
+#define FIB_DEV "/dev/fibonacci"
+#define BUFFER_SIZE 1024
+#define OFFSET 500
+
+int main()
+{
+    char buf[BUFFER_SIZE];
+
+    int fd = open(FIB_DEV, O_RDWR);
+    if (fd < 0) {
+        perror("Failed to open character device");
+        exit(1);
+    }
+
+    for (int i = 1; i <= OFFSET; ++i) {
+        lseek(fd, i, SEEK_SET);
+        unsigned long long dec6 = write(fd, buf, FIB_SIZE(6, FIB_FMT_DEC));
+        unsigned long long hex6 = write(fd, buf, FIB_SIZE(6, FIB_FMT_HEX));
+        unsigned long long raw6 = write(fd, buf, FIB_SIZE(6, FIB_FMT_RAW));
+        unsigned long long dec7 = write(fd, buf, FIB_SIZE(7, FIB_FMT_DEC));
+        unsigned long long hex7 = write(fd, buf, FIB_SIZE(7, FIB_FMT_HEX));
+        unsigned long long raw7 = write(fd, buf, FIB_SIZE(7, FIB_FMT_RAW));
+        /* Here, FIB_SIZE() packs the algorithm and the output format into
+         * the "size" parameter of write system call
+         *
+         * mode 6: bignum_bin_fast_doubling_clz
+         * mode 7: BIGNUM_fast_doubling_clz
+         * each of them rendered in decimal, hex and raw limbs
+         */
+        printf("%d %llu %llu %llu %llu %llu %llu\n", i, dec6, hex6, raw6, dec7, hex7, raw7);
+    }
+    close(fd);
+    return 0;
+}
@@ -0,0 +1,59 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "fibdrv.h"
+
+/*
+ * Times one large index over and over, for perf stat to watch (perf_tlb.sh)
+ * and for perf record (profile.sh). The result is rendered as raw limbs by
+ * default, so the time is the multiply and not the decimal conversion;
+ * "format" (0 decimal, 1 hex, 2 raw) brings the conversion in. Prints the
+ * kernel time of every run in ns.
+ * Mode 8 answers the repeats from its memo, so the default is mode 10.
+ *
+ * usage: get_time_large [mode] [index] [repeat] [format]
+ *
+ * max_index, request_mem_limit and global_mem_limit of the module have to be
+ * raised for indices of this size.
+ */
+
+#define FIB_DEV "/dev/fibonacci"
+#define MODE FIB_MODE_LIMB_LUCAS
+#define INDEX 10000000
+#define REPEAT 5
+
+int main(int argc, char *argv[])
+{
+    int mode = argc > 1 ? atoi(argv[1]) : MODE;
+    off_t index = argc > 2 ? atoll(argv[2]) : INDEX;
+    int repeat = argc > 3 ? atoi(argv[3]) : REPEAT;
+    int fmt = argc > 4 ? atoi(argv[4]) : FIB_FMT_RAW;
+    char buf[1];
+
+    if (fmt < 0 || fmt >= FIB_FMT_NR) {
+        fprintf(stderr, "usage: %s [mode] [index] [repeat] [format]\n", argv[0]);
+        exit(1);
+    }
+
+    int fd = open(FIB_DEV, O_RDWR);
+    if (fd < 0) {
+        perror("Failed to open character device");
+        exit(1);
+    }
+
+    for (int i = 0; i < repeat; ++i) {
+        lseek(fd, index, SEEK_SET);
+        ssize_t ns = write(fd, buf, FIB_SIZE(mode, fmt));
+        if (ns < 0) {
+            perror("write");
+            exit(1);
+        }
+        printf("%zd\n", ns);
+    }
+
+    close(fd);
+    return 0;
+}
@@ -0,0 +1,88 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "fibdrv.h"
+
+#define FIB_DEV "/dev/fibonacci"
+#define FIB_MEMO_PARAM "/sys/module/fibdrv/parameters/memo"
+#define FIB_MEMO_SYSFS "/sys/class/fibonacci/fibonacci/memo/"
+#define BUFFER_SIZE 1024
+#define OFFSET 500
+
+/* turn the memo of mode 8 on or off, needs root */
+static int set_memo(int on)
+{
+    FILE *fp = fopen(FIB_MEMO_PARAM, "w");
+    if (!fp) {
+        return -1;
+    }
+    fputs(on ? "Y" : "N", fp);
+    return fclose(fp);
+}
+
+static long long read_counter(const char *name)
+{
+    char path[128];
+    long long value = -1;
+
+    snprintf(path, sizeof(path), FIB_MEMO_SYSFS "%s", name);
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        return -1;
+    }
+    if (fscanf(fp, "%lld", &value) != 1) {
+        value = -1;
+    }
+    fclose(fp);
+
+    return value;
+}
+
+/* time a sequential sweep of mode @mode into @times */
+static void sweep(int fd, int mode, unsigned long long *times)
+{
+    char buf[BUFFER_SIZE];
+
+    for (int i = 1; i <= OFFSET; ++i) {
+        lseek(fd, i, SEEK_SET);
+        times[i] = write(fd, buf, mode);
+    }
+}
+
+int main()
+{
+    static unsigned long long plain[OFFSET + 1], memo[OFFSET + 1], clz[OFFSET + 1];
+
+    int fd = open(FIB_DEV, O_RDWR);
+    if (fd < 0) {
+        perror("Failed to open character device");
+        exit(1);
+    }
+
+    if (set_memo(0) < 0) {
+        perror("Failed to turn the memo off");
+        exit(1);
+    }
+    sweep(fd, FIB_MODE_LIMB, plain);
+
+    long long hits = read_counter("hits"), steps = read_counter("steps");
+    long long jumps = read_counter("jumps"), misses = read_counter("misses");
+    set_memo(1);
+    sweep(fd, FIB_MODE_LIMB, memo);
+    sweep(fd, FIB_MODE_BIN_FAST_DOUBLING_CLZ, clz);
+    close(fd);
+
+    /* index, mode 8 without memo, mode 8 with memo, mode 6 for reference */
+    for (int i = 1; i <= OFFSET; ++i) {
+        printf("%d %llu %llu %llu\n", i, plain[i], memo[i], clz[i]);
+    }
+
+    fprintf(stderr, "memo: %lld hits, %lld steps, %lld jumps, %lld misses\n",
+            read_counter("hits") - hits, read_counter("steps") - steps,
+            read_counter("jumps") - jumps, read_counter("misses") - misses);
+    return 0;
+}
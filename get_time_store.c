@@ -0,0 +1,120 @@
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "fibdrv.h"
+
+/*
+ * Lookup latency of the precomputed store against computing the same index.
+ * Walks the indices of a store file, which the module must have loaded at
+ * init, and prints per index:
+ *
+ *   k, raw lookup, first decimal lookup, cached decimal lookup, compute (ns)
+ *
+ * The lookups are pread() round trips timed in userspace, the compute time
+ * is what write() reports for mode 10 in raw format.
+ *
+ * usage: get_time_store store_file
+ */
+
+#define FIB_DEV "/dev/fibonacci"
+#define FIB_STORE_SYSFS "/sys/class/fibonacci/fibonacci/store/"
+
+static long long read_counter(const char *name)
+{
+    char path[128];
+    long long value = -1;
+
+    snprintf(path, sizeof(path), FIB_STORE_SYSFS "%s", name);
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        return -1;
+    }
+    if (fscanf(fp, "%lld", &value) != 1) {
+        value = -1;
+    }
+    fclose(fp);
+
+    return value;
+}
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static uint64_t time_read(int fd, char *buf, size_t size, off_t k)
+{
+    uint64_t start = now_ns();
+    if (pread(fd, buf, size, k) < 0) {
+        perror("pread");
+        exit(1);
+    }
+    return now_ns() - start;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s store_file\n", argv[0]);
+        exit(1);
+    }
+
+    FILE *store = fopen(argv[1], "rb");
+    if (!store) {
+        perror("fopen");
+        exit(1);
+    }
+    struct fib_store_hdr hdr;
+    if (fread(&hdr, sizeof(hdr), 1, store) != 1 || hdr.magic != FIB_STORE_MAGIC) {
+        fprintf(stderr, "%s is not a store file\n", argv[1]);
+        exit(1);
+    }
+
+    int fd = open(FIB_DEV, O_RDWR);
+    if (fd < 0) {
+        perror("Failed to open character device");
+        exit(1);
+    }
+
+    fprintf(stderr, "store: %lld entries, %lld bytes, loaded in %lld ns\n",
+            read_counter("entries"), read_counter("bytes"), read_counter("load_ns"));
+
+    long long lookups = read_counter("lookups");
+    struct fib_store_rec rec;
+    for (unsigned int i = 0; i < hdr.count && fread(&rec, sizeof(rec), 1, store) == 1; ++i) {
+        fseek(store, rec.limbs * 8L, SEEK_CUR);
+
+        /* a decimal digit per 3.3 bits, and at least the "size" of read */
+        size_t room = rec.limbs * 20 + 4096;
+        char *buf = malloc(room);
+        if (!buf) {
+            perror("malloc");
+            exit(1);
+        }
+
+        uint64_t raw = time_read(fd, buf, FIB_SIZE(FIB_MODE_LIMB_LUCAS, FIB_FMT_RAW), rec.k);
+        uint64_t dec = time_read(fd, buf, FIB_SIZE(FIB_MODE_LIMB_LUCAS, FIB_FMT_DEC), rec.k);
+        uint64_t cached = time_read(fd, buf, FIB_SIZE(FIB_MODE_LIMB_LUCAS, FIB_FMT_DEC), rec.k);
+
+        lseek(fd, rec.k, SEEK_SET);
+        ssize_t compute = write(fd, buf, FIB_SIZE(FIB_MODE_LIMB_LUCAS, FIB_FMT_RAW));
+
+        printf("%llu %llu %llu %llu %zd\n", (unsigned long long) rec.k,
+               (unsigned long long) raw, (unsigned long long) dec,
+               (unsigned long long) cached, compute);
+        free(buf);
+    }
+
+    fprintf(stderr, "store: %lld lookups\n", read_counter("lookups") - lookups);
+    close(fd);
+    fclose(store);
+
+    return 0;
+}
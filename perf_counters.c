@@ -0,0 +1,293 @@
+/* perf_counters.c */
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/perf_event.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "fibdrv.h"
+
+/*
+ * Hardware counters of every mode, per output bit.
+ *
+ * The counters form one perf_event_open() group on the calling thread,
+ * kernel side only, and are enabled around the write() that runs a mode.
+ * The sums over the repeats are divided by the bits of F(k), about
+ * 0.694 k, so modes and indices compare directly. One CSV row per mode and
+ * index:
+ *
+ *   mode,index,bits,cycles,instructions,ipc,branch_misses,l1d_misses,
+ *   llc_misses,dtlb_misses, and the same six counters per bit
+ *
+ * A counter the CPU lacks is dropped and reported as -1.
+ * Needs perf_event_paranoid <= 1 (or root) for kernel side counting, and
+ * root for mode 8: after the warm-up its repeats would be answered by the
+ * memo, so the memo parameter is off for the run. Without it mode 8 is
+ * skipped.
+ *
+ * usage: perf_counters [-m mode,mode,...] [-k index,index,...] [-r repeat]
+ */
+
+#define FIB_DEV "/dev/fibonacci"
+#define MEMO_PARAM "/sys/module/fibdrv/parameters/memo"
+#define MAX_LIST 64
+/* the native modes are right up to F(93) */
+#define NATIVE_MAX 93
+/* log2 of the golden ratio, F(k) has about that many bits per index */
+#define BITS_PER_INDEX 0.69424191363
+
+enum { CYCLES, INSTRUCTIONS, BRANCH_MISSES, L1D_MISSES, LLC_MISSES, DTLB_MISSES, NR_EVENTS };
+
+#define CACHE_READ_MISS(cache) \
+    ((cache) | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16))
+
+static const struct {
+    const char *name;
+    __u32 type;
+    __u64 config;
+} events[NR_EVENTS] = {
+    [CYCLES] = {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    [INSTRUCTIONS] = {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    [BRANCH_MISSES] = {"branch_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    [L1D_MISSES] = {"l1d_misses", PERF_TYPE_HW_CACHE, CACHE_READ_MISS(PERF_COUNT_HW_CACHE_L1D)},
+    [LLC_MISSES] = {"llc_misses", PERF_TYPE_HW_CACHE, CACHE_READ_MISS(PERF_COUNT_HW_CACHE_LL)},
+    [DTLB_MISSES] = {"dtlb_misses", PERF_TYPE_HW_CACHE, CACHE_READ_MISS(PERF_COUNT_HW_CACHE_DTLB)},
+};
+
+static int leader = -1;
+static int event_fd[NR_EVENTS];
+/* position of each open event in the group read, -1 when missing */
+static int slot[NR_EVENTS];
+static int nr_open;
+
+static int perf_open(int i, int group)
+{
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = events[i].type;
+    attr.config = events[i].config;
+    attr.disabled = group < 0;
+    attr.exclude_user = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                       PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    return syscall(__NR_perf_event_open, &attr, 0, -1, group, 0);
+}
+
+static void perf_setup(void)
+{
+    for (int i = 0; i < NR_EVENTS; ++i) {
+        slot[i] = -1;
+        event_fd[i] = perf_open(i, leader);
+        if (event_fd[i] < 0) {
+            fprintf(stderr, "%s: %s, dropped\n", events[i].name, strerror(errno));
+            if (i == CYCLES) {
+                exit(1);
+            }
+            continue;
+        }
+        if (leader < 0) {
+            leader = event_fd[i];
+        }
+        slot[i] = nr_open++;
+    }
+}
+
+/* read the group, scaled up if the group was multiplexed */
+static void perf_read(uint64_t *count)
+{
+    uint64_t buf[3 + NR_EVENTS];
+
+    if (read(leader, buf, sizeof(buf)) < 0) {
+        perror("read counters");
+        exit(1);
+    }
+    double scale = buf[2] ? (double) buf[1] / buf[2] : 1.0;
+    for (int i = 0; i < NR_EVENTS; ++i) {
+        count[i] = slot[i] < 0 ? 0 : (uint64_t)(buf[3 + slot[i]] * scale);
+    }
+}
+
+/* the memo setting to put back, 0 while untouched */
+static char saved_memo;
+
+static int memo_set(char c)
+{
+    int fd = open(MEMO_PARAM, O_WRONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    int ok = write(fd, &c, 1) == 1;
+    close(fd);
+    return ok ? 0 : -1;
+}
+
+static void memo_restore(void)
+{
+    if (saved_memo) {
+        memo_set(saved_memo);
+    }
+}
+
+static void memo_restore_signal(int sig)
+{
+    memo_restore();
+    _exit(128 + sig);
+}
+
+/* turn the memo of mode 8 off until exit, return 0 or -1 if not allowed */
+static int memo_off(void)
+{
+    char c;
+    int fd = open(MEMO_PARAM, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    int ok = read(fd, &c, 1) == 1;
+    close(fd);
+    if (!ok || memo_set('N') < 0) {
+        return -1;
+    }
+
+    saved_memo = c;
+    atexit(memo_restore);
+    signal(SIGINT, memo_restore_signal);
+    signal(SIGTERM, memo_restore_signal);
+    return 0;
+}
+
+/* parse "1,2,4" into @list, return the number of entries */
+static int parse_list(char *arg, long long *list, int max)
+{
+    int n = 0;
+    for (char *tok = strtok(arg, ","); tok && n < max; tok = strtok(NULL, ",")) {
+        list[n++] = atoll(tok);
+    }
+    return n;
+}
+
+int main(int argc, char *argv[])
+{
+    long long modes[MAX_LIST], index[MAX_LIST] = {90, 1000, 10000, 100000};
+    int nr_modes = 0, nr_index = 4, repeat = 5;
+    int c;
+
+    while ((c = getopt(argc, argv, "m:k:r:")) != -1) {
+        switch (c) {
+        case 'm':
+            nr_modes = parse_list(optarg, modes, MAX_LIST);
+            break;
+        case 'k':
+            nr_index = parse_list(optarg, index, MAX_LIST);
+            break;
+        case 'r':
+            repeat = atoi(optarg);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-m mode,mode,...] [-k index,index,...] [-r repeat]\n",
+                    argv[0]);
+            exit(1);
+        }
+    }
+    if (nr_modes == 0) {
+        for (int m = 0; m < FIB_MODE_NR; ++m) {
+            modes[nr_modes++] = m;
+        }
+    }
+
+    int fd = open(FIB_DEV, O_RDWR);
+    if (fd < 0) {
+        perror("Failed to open character device");
+        exit(1);
+    }
+    /* raw output, so the counters see the algorithm and not the decimal conversion */
+    int fmt = FIB_FMT_RAW;
+    if (ioctl(fd, FIB_IOC_SET_FORMAT, &fmt) < 0) {
+        perror("FIB_IOC_SET_FORMAT");
+        exit(1);
+    }
+
+    perf_setup();
+
+    int memo_on = memo_off() < 0;
+    if (memo_on) {
+        fprintf(stderr, "%s: %s, mode 8 would count its memo and is skipped\n", MEMO_PARAM,
+                strerror(errno));
+    }
+
+    printf("mode,index,bits");
+    for (int i = 0; i < NR_EVENTS; ++i) {
+        printf(",%s%s", events[i].name, i == INSTRUCTIONS ? ",ipc" : "");
+    }
+    for (int i = 0; i < NR_EVENTS; ++i) {
+        printf(",%s_per_bit", events[i].name);
+    }
+    printf("\n");
+
+    for (int j = 0; j < nr_index; ++j) {
+        for (int i = 0; i < nr_modes; ++i) {
+            int mode = modes[i];
+            long long k = index[j];
+            if ((mode <= FIB_MODE_FAST_DOUBLING_CLZ && k > NATIVE_MAX) ||
+                (mode == FIB_MODE_LIMB && memo_on)) {
+                continue;
+            }
+
+            char dummy[FIB_MODE_NR + 1];
+            uint64_t before[NR_EVENTS], after[NR_EVENTS];
+            int failed = 0;
+
+            /* a warm-up run, then the counted ones */
+            lseek(fd, k, SEEK_SET);
+            write(fd, dummy, mode);
+
+            perf_read(before);
+            ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+            for (int r = 0; r < repeat; ++r) {
+                lseek(fd, k, SEEK_SET);
+                failed |= write(fd, dummy, mode) < 0;
+            }
+            ioctl(leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+            perf_read(after);
+
+            if (failed) {
+                fprintf(stderr, "mode %d F(%lld): %s\n", mode, k, strerror(errno));
+                continue;
+            }
+
+            double bits = k * BITS_PER_INDEX;
+            double per_run[NR_EVENTS];
+            for (int e = 0; e < NR_EVENTS; ++e) {
+                per_run[e] = slot[e] < 0 ? -1 : (double) (after[e] - before[e]) / repeat;
+            }
+
+            printf("%d,%lld,%.0f", mode, k, bits);
+            for (int e = 0; e < NR_EVENTS; ++e) {
+                printf(",%.0f", per_run[e]);
+                if (e == INSTRUCTIONS) {
+                    printf(",%.3f", per_run[CYCLES] > 0 && per_run[INSTRUCTIONS] >= 0
+                                        ? per_run[INSTRUCTIONS] / per_run[CYCLES] : -1);
+                }
+            }
+            for (int e = 0; e < NR_EVENTS; ++e) {
+                printf(",%.4f", per_run[e] < 0 || bits < 1 ? -1 : per_run[e] / bits);
+            }
+            printf("\n");
+            fflush(stdout);
+        }
+    }
+
+    close(leader);
+    close(fd);
+    return 0;
+}
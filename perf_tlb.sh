@@ -0,0 +1,48 @@
+#!/bin/bash
+# dTLB misses and time of one large index under every large_alloc policy
+#
+# usage: sudo ./perf_tlb.sh [mode] [index] [repeat] > tlb.csv
+#
+# large_alloc: 0 kvmalloc, 1 local node, 2 huge pages, 3 interleaved
+# huge pages only show up once a buffer spans a whole PMD (2 MiB on x86-64).
+# F(k) takes about k / 11.5 bytes, so at F(10^7) even the 2 x 108k limb
+# product is 1.74 MB and policies 1 and 2 are the same; the default index
+# puts the operands themselves past 2 MiB. The memory limits, max_index and
+# large_alloc are put back on exit.
+
+MODE=${1:-10}
+INDEX=${2:-25000000}
+REPEAT=${3:-5}
+PARAM=/sys/module/fibdrv/parameters
+EVENTS=dTLB-loads,dTLB-load-misses,dTLB-stores,dTLB-store-misses
+
+saved_max_index=$(cat $PARAM/max_index)
+saved_request_mem=$(cat $PARAM/request_mem_limit)
+saved_global_mem=$(cat $PARAM/global_mem_limit)
+saved_large_alloc=$(cat $PARAM/large_alloc)
+
+restore()
+{
+    echo $saved_max_index > $PARAM/max_index
+    echo $saved_request_mem > $PARAM/request_mem_limit
+    echo $saved_global_mem > $PARAM/global_mem_limit
+    echo $saved_large_alloc > $PARAM/large_alloc
+    rm -f perf.tmp time.tmp
+}
+trap restore EXIT
+
+# room for the index, a few buffers of ~index/11 bytes each
+echo $INDEX > $PARAM/max_index
+echo 0 > $PARAM/request_mem_limit
+echo 0 > $PARAM/global_mem_limit
+
+echo "large_alloc,mean_ns,dTLB-loads,dTLB-load-misses,dTLB-stores,dTLB-store-misses"
+for policy in 0 1 2 3
+do
+    echo $policy > $PARAM/large_alloc
+    # the counters go to perf.tmp as CSV, the times of the client to time.tmp
+    perf stat -x, -e $EVENTS -o perf.tmp ./get_time_large $MODE $INDEX $REPEAT > time.tmp
+    mean=$(awk '{ s += $1 } END { printf "%.0f", s / NR }' time.tmp)
+    counts=$(awk -F, '/dTLB/ { printf ",%s", $1 }' perf.tmp)
+    echo "$policy,$mean$counts"
+done
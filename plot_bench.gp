@@ -0,0 +1,19 @@
+set title "fibdrv scaling"
+set xlabel "threads"
+set ylabel "requests/s"
+set y2label "latency(ns)"
+set datafile separator ","
+set terminal png enhanced font " Times_New_Roman,12 "
+set output "fg_bench.png"
+set key left
+set grid
+set ytics nomirror
+set y2tics
+set logscale x 2
+
+# bench.csv comes from: ./fib_bench -t 1,2,4,8 > bench.csv
+plot \
+"bench.csv" every ::1 using 1:7 with linespoints linewidth 1.5 title "throughput", \
+"bench.csv" every ::1 using 1:8 axes x1y2 with linespoints linewidth 1.5 title "p50 latency", \
+"bench.csv" every ::1 using 1:10 axes x1y2 with linespoints linewidth 1.5 title "p99 latency", \
+"bench.csv" every ::1 using 1:11 axes x1y2 with linespoints linewidth 1.5 title "p99.9 latency"
@@ -0,0 +1,13 @@
+set title "cycles per output bit"
+set xlabel "Fibonacci number"
+set ylabel "cycles/bit"
+set datafile separator ","
+set terminal png enhanced font " Times_New_Roman,12 "
+set output "fg_counters.png"
+set key left
+set grid
+set logscale xy
+
+# counters.csv comes from: ./perf_counters -m 3,4,5,6,7,8,9,10 > counters.csv
+plot for [m=3:10] \
+"counters.csv" every ::1 using 2:($1 == m ? $11 : 1/0) with linespoints linewidth 1.5 title sprintf("mode %d", m)
@@ -0,0 +1,14 @@
+set title "limb add/sub kernels"
+set xlabel "limbs"
+set ylabel "time per limb(ns)"
+set terminal png enhanced font " Times_New_Roman,12 "
+set output "fg_kernels.png"
+set key right
+set grid
+set logscale x 2
+
+plot \
+"kernels.txt" using 1:2 with linespoints linewidth 1.5 title "add, carry chain", \
+"kernels.txt" using 1:3 with linespoints linewidth 1.5 title "add, portable", \
+"kernels.txt" using 1:4 with linespoints linewidth 1.5 title "sub, carry chain", \
+"kernels.txt" using 1:5 with linespoints linewidth 1.5 title "sub, portable"
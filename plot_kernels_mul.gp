@@ -0,0 +1,13 @@
+set title "fixed width mul/sqr kernels"
+set xlabel "limbs a side"
+set ylabel "time per product(ns)"
+set terminal png enhanced font " Times_New_Roman,12 "
+set output "fg_kernels_mul.png"
+set key left
+set grid
+
+plot \
+"kernels_mul.txt" using 1:2 with linespoints linewidth 1.5 title "mul, fixed width", \
+"kernels_mul.txt" using 1:3 with linespoints linewidth 1.5 title "mul, rows", \
+"kernels_mul.txt" using 1:4 with linespoints linewidth 1.5 title "sqr, fixed width", \
+"kernels_mul.txt" using 1:5 with linespoints linewidth 1.5 title "sqr, rows"
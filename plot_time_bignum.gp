@@ -12,3 +12,5 @@ plot \
 "time_bignum.txt" using 1:4 with linespoints linewidth 1.5 title "bignum\\\_bin fast doubling", \
 "time_bignum.txt" using 1:5 with linespoints linewidth 1.5 title "bignum\\\_bin fast doubling with clz", \
 "time_bignum.txt" using 1:6 with linespoints linewidth 1.5 title "BIGNUM\\\_fast doubling with clz", \
+"time_bignum.txt" using 1:7 with linespoints linewidth 1.5 title "bignum\\\_limb matrix", \
+"time_bignum.txt" using 1:8 with linespoints linewidth 1.5 title "bignum\\\_limb lucas"
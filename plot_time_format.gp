@@ -0,0 +1,15 @@
+set title "Fibonacci number time by output format"
+set xlabel "Fibonacci number"
+set ylabel "time(ns)"
+set terminal png enhanced font " Times_New_Roman,12 "
+set output "fg_time_format.png"
+set key left 
+set grid
+
+plot \
+"time_format.txt" using 1:2 with linespoints linewidth 1.5 title "bignum\\\_bin decimal", \
+"time_format.txt" using 1:3 with linespoints linewidth 1.5 title "bignum\\\_bin hex", \
+"time_format.txt" using 1:4 with linespoints linewidth 1.5 title "bignum\\\_bin raw", \
+"time_format.txt" using 1:5 with linespoints linewidth 1.5 title "BIGNUM decimal", \
+"time_format.txt" using 1:6 with linespoints linewidth 1.5 title "BIGNUM hex", \
+"time_format.txt" using 1:7 with linespoints linewidth 1.5 title "BIGNUM raw", \
@@ -0,0 +1,12 @@
+set title "Fibonacci number time, sequential sweep"
+set xlabel "Fibonacci number"
+set ylabel "time(ns)"
+set terminal png enhanced font " Times_New_Roman,12 "
+set output "fg_time_memo.png"
+set key left 
+set grid
+
+plot \
+"time_memo.txt" using 1:2 with linespoints linewidth 1.5 title "bignum\\\_limb fast doubling", \
+"time_memo.txt" using 1:3 with linespoints linewidth 1.5 title "bignum\\\_limb with memo", \
+"time_memo.txt" using 1:4 with linespoints linewidth 1.5 title "bignum\\\_bin fast doubling with clz"
@@ -0,0 +1,89 @@
+#!/bin/bash
+# profile the bignum routines of fibdrv with perf record
+#
+# usage: sudo ./profile.sh [outdir] [modes] [indices] [repeat] [format]
+#   e.g. sudo ./profile.sh prof "5 6 7 8" "100 1000 10000" 20
+#   or   make profile PROFILE_ARGS='prof "5 6" "1000 10000"'
+#
+# For every index bucket, get_time_large runs each mode "repeat" times under
+# perf record -g, rendering in "format" (0 decimal, the default, so the
+# conversions such as bignum_bin_to_decimal show up; 1 hex; 2 raw, for the
+# arithmetic alone), which leaves per bucket in outdir:
+#   perf-<index>.data    the samples
+#   perf-<index>.folded  folded stacks, if FlameGraph is around
+#   perf-<index>.svg     the flame graph
+# and prints the self time of every fibdrv function per bucket (the share
+# of all samples of that bucket), so a change can show its before/after.
+#
+# FlameGraph (https://github.com/brendangregg/FlameGraph) is looked up in
+# $FLAMEGRAPH_DIR, then in $PATH. Kernel samples need perf_event_paranoid <= 1.
+
+OUT=${1:-profile}
+MODES=${2:-"4 5 6 7 8 9 10"}
+INDICES=${3:-"100 1000 10000"}
+REPEAT=${4:-20}
+FORMAT=${5:-0}
+PARAM=/sys/module/fibdrv/parameters
+
+FG=${FLAMEGRAPH_DIR:+$FLAMEGRAPH_DIR/}
+if ! command -v ${FG}stackcollapse-perf.pl > /dev/null; then
+    echo "FlameGraph not found, skipping the flame graphs" >&2
+    FG=""
+    NO_FLAMEGRAPH=1
+fi
+
+mkdir -p $OUT
+
+max=0
+for k in $INDICES
+do
+    [ $k -gt $max ] && max=$k
+done
+saved=$(cat $PARAM/max_index)
+saved_memo=$(cat $PARAM/memo)
+trap 'echo $saved > $PARAM/max_index; echo $saved_memo > $PARAM/memo' EXIT
+[ $max -gt $saved ] && echo $max > $PARAM/max_index
+# the repeats of mode 8 would be answered by its memo
+echo N > $PARAM/memo
+
+for k in $INDICES
+do
+    perf record -q -g -o $OUT/perf-$k.data -- \
+        sh -c "for m in $MODES; do ./get_time_large \$m $k $REPEAT $FORMAT > /dev/null; done"
+
+    if [ -z "$NO_FLAMEGRAPH" ]; then
+        perf script -i $OUT/perf-$k.data 2> /dev/null |
+            ${FG}stackcollapse-perf.pl > $OUT/perf-$k.folded
+        ${FG}flamegraph.pl --title "fibdrv, F($k), modes $MODES, format $FORMAT" \
+            $OUT/perf-$k.folded > $OUT/perf-$k.svg
+    fi
+
+    # "  42.17%  [fibdrv]  [k] bignum_bin_mul" -> "bignum_bin_mul 42.17"
+    perf report -i $OUT/perf-$k.data --no-children --sort dso,sym --stdio -q 2> /dev/null |
+        awk '$2 == "[fibdrv]" { sub("%", "", $1); print $4, $1 }' > $OUT/self-$k.txt
+done
+
+# one row per function, one column per bucket, sorted by the last bucket
+{
+    printf "%-36s" "function"
+    for k in $INDICES
+    do
+        printf "%12s" "F($k)"
+    done
+    printf "\n"
+
+    for k in $INDICES
+    do
+        cat $OUT/self-$k.txt
+    done | awk '{ print $1 }' | sort -u |
+    while read fn
+    do
+        printf "%-36s" $fn
+        for k in $INDICES
+        do
+            pct=$(awk -v fn=$fn '$1 == fn { print $2 }' $OUT/self-$k.txt)
+            printf "%11s%%" ${pct:-0}
+        done
+        printf "\n"
+    done | awk '{ v = $NF; sub("%", "", v); print v "\t" $0 }' | sort -rn | cut -f2-
+} | tee $OUT/self.txt
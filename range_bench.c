@@ -0,0 +1,134 @@
+/* range_bench.c */
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "fibdrv.h"
+
+/*
+ * Scaling of FIB_IOC_RANGE over the number of chunks, i.e. kernel workers,
+ * for F(first) ~ F(last). Every chunk count from 1 on doubles up to
+ * "chunks" (the online CPUs by default), and each takes the best of
+ * "repeat" calls. The output of every count is hashed and checked against
+ * the one of a single chunk.
+ *
+ * One CSV row per chunk count:
+ *
+ *   chunks,first,last,bytes,seconds,numbers_per_sec,speedup
+ *
+ * usage: range_bench [first] [last] [chunks] [repeat] [format]
+ *
+ * The module has to allow last (max_index), and the output (about
+ * 0.1 * last^2 bytes from 0 in decimal) has to fit in request_mem_limit.
+ */
+
+#define FIB_DEV "/dev/fibonacci"
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* FNV-1a */
+static uint64_t hash(const char *s, size_t len)
+{
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < len; ++i) {
+        h = (h ^ (unsigned char) s[i]) * 0x100000001b3ULL;
+    }
+    return h;
+}
+
+int main(int argc, char *argv[])
+{
+    long long first = argc > 1 ? atoll(argv[1]) : 0;
+    long long last = argc > 2 ? atoll(argv[2]) : 10000;
+    int max_chunks = argc > 3 ? atoi(argv[3]) : sysconf(_SC_NPROCESSORS_ONLN);
+    int repeat = argc > 4 ? atoi(argv[4]) : 3;
+    int fmt = argc > 5 ? atoi(argv[5]) : FIB_FMT_DEC;
+
+    if (first < 0 || last < first || max_chunks < 1 || repeat < 1 || fmt == FIB_FMT_RAW) {
+        fprintf(stderr, "usage: %s [first] [last] [chunks] [repeat] [format]\n", argv[0]);
+        exit(1);
+    }
+
+    int fd = open(FIB_DEV, O_RDWR);
+    if (fd < 0) {
+        perror("Failed to open character device");
+        exit(1);
+    }
+    if (ioctl(fd, FIB_IOC_SET_FORMAT, &fmt) < 0) {
+        perror("FIB_IOC_SET_FORMAT");
+        exit(1);
+    }
+
+    /* F(k) has at most 0.209 k + 1 decimal or 0.174 k + 1 hex digits */
+    double rate = fmt == FIB_FMT_DEC ? 0.20899 : 0.17357;
+    long long count = last - first + 1;
+    size_t size = rate * (first + last) * count / 2 + count * 2 + 1;
+    char *buf = malloc(size);
+    if (!buf) {
+        perror("malloc");
+        exit(1);
+    }
+
+    printf("chunks,first,last,bytes,seconds,numbers_per_sec,speedup\n");
+
+    uint64_t expect = 0;
+    double base = 0;
+    for (int chunks = 1;; chunks = chunks * 2 < max_chunks ? chunks * 2 : max_chunks) {
+        struct fib_range_req req;
+        uint64_t best = UINT64_MAX;
+        for (int r = 0; r < repeat; ++r) {
+            req = (struct fib_range_req){
+                .first = first,
+                .last = last,
+                .buf = (uintptr_t) buf,
+                .size = size,
+                .chunks = chunks,
+            };
+            uint64_t t = now_ns();
+            if (ioctl(fd, FIB_IOC_RANGE, &req) < 0) {
+                perror("FIB_IOC_RANGE");
+                exit(1);
+            }
+            t = now_ns() - t;
+            if (t < best) {
+                best = t;
+            }
+        }
+
+        uint64_t h = hash(buf, req.len);
+        if (chunks == 1) {
+            expect = h;
+        }
+        else if (h != expect) {
+            fprintf(stderr, "%d chunks disagree with one\n", chunks);
+            exit(1);
+        }
+
+        double sec = best / 1e9;
+        if (chunks == 1) {
+            base = sec;
+        }
+        printf("%d,%lld,%lld,%llu,%.6f,%.0f,%.2f\n", chunks, first, last,
+               (unsigned long long) req.len, sec, (last - first + 1) / sec, base / sec);
+        fflush(stdout);
+
+        if (chunks == max_chunks) {
+            break;
+        }
+    }
+
+    free(buf);
+    close(fd);
+    return 0;
+}
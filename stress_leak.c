@@ -0,0 +1,128 @@
+/* stress_leak.c */
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "fibdrv.h"
+
+#define FIB_DEV "/dev/fibonacci"
+#define FIB_SYSFS "/sys/class/fibonacci/fibonacci/alloc/"
+#define KMEMLEAK "/sys/kernel/debug/kmemleak"
+#define BUFFER_SIZE 1024
+#define OFFSET 500
+#define ROUNDS 20
+
+static long long read_counter(const char *name)
+{
+    char path[128];
+    long long value = -1;
+
+    snprintf(path, sizeof(path), FIB_SYSFS "%s", name);
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        return -1;
+    }
+    if (fscanf(fp, "%lld", &value) != 1) {
+        value = -1;
+    }
+    fclose(fp);
+
+    return value;
+}
+
+/* ask kmemleak for a scan and return how many suspects were allocated by fibdrv */
+static int kmemleak_suspects(void)
+{
+    FILE *fp = fopen(KMEMLEAK, "w");
+    if (!fp) {
+        return -1;
+    }
+    fputs("scan", fp);
+    fclose(fp);
+
+    fp = fopen(KMEMLEAK, "r");
+    if (!fp) {
+        return -1;
+    }
+
+    /* each report starts with "unreferenced object", followed by its backtrace */
+    char line[256];
+    int suspects = 0, counted = 1;
+    while (fgets(line, sizeof(line), fp)) {
+        if (strncmp(line, "unreferenced object", 19) == 0) {
+            counted = 0;
+        }
+        else if (!counted && strstr(line, "[fibdrv]")) {
+            suspects++;
+            counted = 1;
+        }
+    }
+    fclose(fp);
+
+    return suspects;
+}
+
+int main()
+{
+    char buf[BUFFER_SIZE];
+
+    int fd = open(FIB_DEV, O_RDWR);
+    if (fd < 0) {
+        perror("Failed to open character device");
+        exit(1);
+    }
+
+    long long first_in_use = -1;
+    int failed = 0;
+
+    for (int round = 0; round < ROUNDS; ++round) {
+        /* every bignum mode, every format, through both read and write */
+        for (int mode = 3; mode < FIB_MODE_NR; ++mode) {
+            for (int fmt = 0; fmt < FIB_FMT_NR; ++fmt) {
+                for (int i = 0; i <= OFFSET; ++i) {
+                    lseek(fd, i, SEEK_SET);
+                    read(fd, buf, FIB_SIZE(mode, fmt));
+                    write(fd, buf, FIB_SIZE(mode, fmt));
+                }
+            }
+        }
+
+        long long in_use = read_counter("bytes_in_use");
+        long long outstanding = read_counter("allocs") - read_counter("frees");
+        printf("round %d: bytes_in_use %lld, outstanding buffers %lld\n", round,
+               in_use, outstanding);
+
+        /* the first round sizes the reused result buffer, it must stay flat after that */
+        if (round == 0) {
+            first_in_use = in_use;
+        }
+        else if (in_use > first_in_use) {
+            printf("bytes_in_use grew from %lld to %lld\n", first_in_use, in_use);
+            failed = 1;
+        }
+    }
+    close(fd);
+
+    long long in_use = read_counter("bytes_in_use");
+    printf("after close: bytes_in_use %lld\n", in_use);
+    if (in_use != 0) {
+        failed = 1;
+    }
+
+    int suspects = kmemleak_suspects();
+    if (suspects < 0) {
+        printf("kmemleak not available, skipped\n");
+    }
+    else {
+        printf("kmemleak: %d unreferenced objects\n", suspects);
+        if (suspects > 0) {
+            failed = 1;
+        }
+    }
+
+    printf("%s\n", failed ? "FAIL" : "PASS");
+    return failed;
+}
@@ -0,0 +1,257 @@
+/* uring_bench.c */
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "fibdrv.h"
+
+/*
+ * Drives fibonacci requests through io_uring (IORING_OP_READ_FIXED on
+ * registered buffers, up to QUEUE_DEPTH in flight) and compares the QPS with
+ * the classic lseek + read loop and with synchronous preadv.
+ *
+ * usage: uring_bench [mode] [queue depth] [requests]
+ */
+
+#define FIB_DEV "/dev/fibonacci"
+#define MODE 6
+#define QUEUE_DEPTH 256
+#define REQUESTS 100000
+#define MAX_OFFSET 500
+/* F(500) has 105 decimal digits */
+#define BUFFER_SIZE 256
+#define SEED 2024
+
+struct ring {
+    int fd;
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    struct io_uring_sqe *sqes;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_cqe *cqes;
+};
+
+static int ring_init(struct ring *ring, unsigned entries)
+{
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+
+    ring->fd = syscall(__NR_io_uring_setup, entries, &p);
+    if (ring->fd < 0) {
+        return -1;
+    }
+
+    size_t sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    size_t cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        sq_size = cq_size = (sq_size > cq_size) ? sq_size : cq_size;
+    }
+
+    char *sq = mmap(NULL, sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                    ring->fd, IORING_OFF_SQ_RING);
+    if (sq == MAP_FAILED) {
+        return -1;
+    }
+
+    char *cq = sq;
+    if (!(p.features & IORING_FEAT_SINGLE_MMAP)) {
+        cq = mmap(NULL, cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                  ring->fd, IORING_OFF_CQ_RING);
+        if (cq == MAP_FAILED) {
+            return -1;
+        }
+    }
+
+    ring->sqes = mmap(NULL, p.sq_entries * sizeof(struct io_uring_sqe),
+                      PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd,
+                      IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) {
+        return -1;
+    }
+
+    ring->sq_head = (unsigned *)(sq + p.sq_off.head);
+    ring->sq_tail = (unsigned *)(sq + p.sq_off.tail);
+    ring->sq_mask = (unsigned *)(sq + p.sq_off.ring_mask);
+    ring->sq_array = (unsigned *)(sq + p.sq_off.array);
+    ring->cq_head = (unsigned *)(cq + p.cq_off.head);
+    ring->cq_tail = (unsigned *)(cq + p.cq_off.tail);
+    ring->cq_mask = (unsigned *)(cq + p.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+
+    return 0;
+}
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* the same pseudo random index sequence for every method */
+static int next_offset(unsigned *seed)
+{
+    return rand_r(seed) % MAX_OFFSET + 1;
+}
+
+static void report(const char *method, long requests, long errors, double seconds)
+{
+    printf("%s,%ld,%ld,%.3f,%.0f\n", method, requests, errors, seconds, requests / seconds);
+}
+
+static void bench_lseek_read(int fd, int mode, long requests)
+{
+    char buf[BUFFER_SIZE];
+    unsigned seed = SEED;
+    long errors = 0;
+
+    double start = now_sec();
+    for (long i = 0; i < requests; ++i) {
+        lseek(fd, next_offset(&seed), SEEK_SET);
+        if (read(fd, buf, mode) < 0) {
+            errors++;
+        }
+    }
+    report("lseek+read", requests, errors, now_sec() - start);
+}
+
+static void bench_preadv(int fd, long requests)
+{
+    char buf[BUFFER_SIZE];
+    struct iovec iov = {.iov_base = buf, .iov_len = sizeof(buf)};
+    unsigned seed = SEED;
+    long errors = 0;
+
+    double start = now_sec();
+    for (long i = 0; i < requests; ++i) {
+        if (preadv(fd, &iov, 1, next_offset(&seed)) < 0) {
+            errors++;
+        }
+    }
+    report("preadv", requests, errors, now_sec() - start);
+}
+
+static int bench_io_uring(int fd, unsigned depth, long requests)
+{
+    struct ring ring;
+    if (ring_init(&ring, depth) < 0) {
+        perror("io_uring_setup");
+        return -1;
+    }
+
+    /* one registered buffer per slot, a slot is busy while its read is in flight */
+    char *bufs;
+    if (posix_memalign((void **) &bufs, 4096, (size_t) depth * BUFFER_SIZE) != 0) {
+        bufs = NULL;
+    }
+    struct iovec *iovs = calloc(depth, sizeof(struct iovec));
+    unsigned *free_slots = calloc(depth, sizeof(unsigned));
+    if (!bufs || !iovs || !free_slots) {
+        fprintf(stderr, "out of memory for %u slots\n", depth);
+        close(ring.fd);
+        free(bufs);
+        free(iovs);
+        free(free_slots);
+        return -1;
+    }
+    for (unsigned i = 0; i < depth; ++i) {
+        iovs[i].iov_base = bufs + (size_t) i * BUFFER_SIZE;
+        iovs[i].iov_len = BUFFER_SIZE;
+        free_slots[i] = i;
+    }
+    if (syscall(__NR_io_uring_register, ring.fd, IORING_REGISTER_BUFFERS, iovs, depth) < 0) {
+        perror("IORING_REGISTER_BUFFERS");
+        return -1;
+    }
+
+    unsigned nr_free = depth;
+    unsigned seed = SEED;
+    long submitted = 0, completed = 0, errors = 0;
+
+    double start = now_sec();
+    while (completed < requests) {
+        unsigned tail = *ring.sq_tail;
+        unsigned to_submit = 0;
+
+        while (nr_free > 0 && submitted < requests) {
+            unsigned slot = free_slots[--nr_free];
+            unsigned idx = tail & *ring.sq_mask;
+            struct io_uring_sqe *sqe = &ring.sqes[idx];
+
+            memset(sqe, 0, sizeof(*sqe));
+            sqe->opcode = IORING_OP_READ_FIXED;
+            sqe->fd = fd;
+            sqe->addr = (unsigned long) iovs[slot].iov_base;
+            sqe->len = BUFFER_SIZE;
+            sqe->off = next_offset(&seed);
+            sqe->buf_index = slot;
+            sqe->user_data = slot;
+
+            ring.sq_array[idx] = idx;
+            tail++;
+            to_submit++;
+            submitted++;
+        }
+        __atomic_store_n(ring.sq_tail, tail, __ATOMIC_RELEASE);
+
+        if (syscall(__NR_io_uring_enter, ring.fd, to_submit, 1, IORING_ENTER_GETEVENTS, NULL, 0) < 0) {
+            perror("io_uring_enter");
+            return -1;
+        }
+
+        unsigned head = *ring.cq_head;
+        unsigned cq_tail = __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+        for (; head != cq_tail; ++head) {
+            struct io_uring_cqe *cqe = &ring.cqes[head & *ring.cq_mask];
+            if (cqe->res < 0) {
+                errors++;
+            }
+            free_slots[nr_free++] = (unsigned) cqe->user_data;
+            completed++;
+        }
+        __atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+    }
+    report("io_uring", requests, errors, now_sec() - start);
+
+    close(ring.fd);
+    free(free_slots);
+    free(iovs);
+    free(bufs);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    int mode = argc > 1 ? atoi(argv[1]) : MODE;
+    unsigned depth = argc > 2 ? atoi(argv[2]) : QUEUE_DEPTH;
+    long requests = argc > 3 ? atol(argv[3]) : REQUESTS;
+
+    int fd = open(FIB_DEV, O_RDWR);
+    if (fd < 0) {
+        perror("Failed to open character device");
+        exit(1);
+    }
+
+    /* read_iter takes the algorithm from the open file */
+    if (ioctl(fd, FIB_IOC_SET_MODE, &mode) < 0) {
+        perror("FIB_IOC_SET_MODE");
+        exit(1);
+    }
+
+    printf("method,requests,errors,seconds,qps\n");
+    bench_lseek_read(fd, mode, requests);
+    bench_preadv(fd, requests);
+    bench_io_uring(fd, depth, requests);
+
+    close(fd);
+    return 0;
+}